@@ -0,0 +1,117 @@
+// 一次唤醒产生的一批任务逐个投递(execute)和一次投递(postBatch)的对比
+// 每个投递线程(相当于事件循环)每轮投递B个约1us的任务(相当于一次epoll_wait返回B个就绪连接)，
+// 等积压消化一半后开始下一轮；统计投递方每个任务的耗时和总吞吐
+// 用法: bench_batch [批大小...]，默认1 8 64 512；环境变量THREADS、LOOPS、ROUNDS
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "threadpool/default_pool.h"
+
+struct Work
+{
+    std::atomic<long> done{0};
+
+    void run(uint32_t n)
+    {
+        volatile uint32_t x = 0;
+        for (uint32_t i = 0; i < 300; ++i)
+        {
+            x = x + i * n;
+        }
+        done.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+static int envInt(const char *name, int def)
+{
+    const char *v = getenv(name);
+    return v ? atoi(v) : def;
+}
+
+static void run(int type, bool batch, int burst, int threads, int loops, long rounds)
+{
+    PoolOptions opts;
+    opts.type = type;
+    std::unique_ptr<Executor> pool(newThreadPool(threads, opts));
+    Work work;
+    std::atomic<long> postNS(0);
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> posters;
+    for (int l = 0; l < loops; ++l)
+    {
+        posters.emplace_back([&, l]()
+                             {
+            std::vector<InlineTask> tasks;
+            tasks.reserve(burst);
+            for (long k = 0; k < rounds; ++k)
+            {
+                auto p0 = std::chrono::steady_clock::now();
+                if (batch)
+                {
+                    for (int i = 0; i < burst; ++i)
+                    {
+                        tasks.emplace_back(std::bind(&Work::run, &work, static_cast<uint32_t>(i)));
+                    }
+                    pool->postBatch(tasks.data(), tasks.size());
+                    tasks.clear();
+                }
+                else
+                {
+                    for (int i = 0; i < burst; ++i)
+                    {
+                        pool->execute(std::bind(&Work::run, &work, static_cast<uint32_t>(i)));
+                    }
+                }
+                postNS.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - p0).count(),
+                                 std::memory_order_relaxed);
+                while (work.done.load() < k * burst * loops / 2)
+                {
+                    std::this_thread::yield();
+                }
+            } });
+    }
+    for (auto &t : posters)
+    {
+        t.join();
+    }
+    long total = static_cast<long>(loops) * burst * rounds;
+    while (work.done.load() < total)
+    {
+        std::this_thread::yield();
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("%-8s %-6s B=%4d loops=%d  post %6.1f ns/task  %9.0f tasks/s\n", type == WORK_STEALING_POOL ? "stealing" : "mutex",
+           batch ? "batch" : "single", burst, loops, static_cast<double>(postNS.load()) / total, total / sec);
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<int> bursts;
+    for (int i = 1; i < argc; ++i)
+    {
+        bursts.push_back(atoi(argv[i]));
+    }
+    if (bursts.empty())
+    {
+        bursts = {1, 8, 64, 512};
+    }
+    int threads = envInt("THREADS", 8);
+    int loops = envInt("LOOPS", 2);
+    for (int type : {MUTEX_POOL, WORK_STEALING_POOL})
+    {
+        for (int burst : bursts)
+        {
+            long rounds = envInt("ROUNDS", 0) > 0 ? envInt("ROUNDS", 0) : 200000 / burst + 50;
+            run(type, false, burst, threads, loops, rounds);
+            run(type, true, burst, threads, loops, rounds);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+// CharScan各实现(标量、SSE2、AVX2)的对比: 单独扫描行尾的耗时，以及整个请求的解析耗时
+// 请求头部填充到指定的大小，大的Cookie行模拟真实浏览器请求中的长行
+// 用法: bench_char_scan [头部字节数...]，默认512 1024 8192
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "http/http_request.h"
+
+static std::string makeRequest(size_t target)
+{
+    std::string req = "GET /index.html HTTP/1.1\r\nHost: 192.168.1.10:10000\r\nConnection: keep-alive\r\n"
+                      "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+                      "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+                      "Accept-Encoding: gzip, deflate\r\nAccept-Language: en-US,en;q=0.9\r\n";
+    for (int i = 0; req.size() + 80 < target; ++i)
+    {
+        req += "Cookie: c" + std::to_string(i) + "=";
+        while (req.size() % 200 != 198 && req.size() + 4 < target)
+        {
+            req += "abcdefghij"[req.size() % 10];
+        }
+        req += "\r\n";
+    }
+    while (req.size() + 4 < target)
+    {
+        req += "X-Pad: x\r\n";
+    }
+    return req + "\r\n";
+}
+
+static double parseNS(const std::string &req, long n)
+{
+    Buffer buff(16384);
+    HttpRequest parser;
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; ++i)
+    {
+        buff.initPtr();
+        buff.append(req);
+        if (parser.parse(buff) != HttpRequest::PARSE_COMPLETE)
+        {
+            fprintf(stderr, "parse failed\n");
+            exit(1);
+        }
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n;
+}
+
+static double scanNS(const std::string &req, long n)
+{
+    size_t lines = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; ++i)
+    {
+        const char *p = req.data(), *end = p + req.size();
+        while (p < end)
+        {
+            p = CharScan::findControl(p, end) + 2;
+            ++lines;
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n;
+    if (lines == 0)
+    {
+        exit(1); /* 防止扫描被优化掉 */
+    }
+    return ns;
+}
+
+int main(int argc, char *argv[])
+{
+    spdlog::set_level(spdlog::level::warn);
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i)
+    {
+        sizes.push_back(atol(argv[i]));
+    }
+    if (sizes.empty())
+    {
+        sizes = {512, 1024, 8192};
+    }
+    for (size_t size : sizes)
+    {
+        std::string req = makeRequest(size);
+        long n = 200000000 / req.size();
+        printf("== %zu byte request\n", req.size());
+        for (int isa = CharScan::SCALAR; isa < CharScan::ISA_NUM; ++isa)
+        {
+            if (!CharScan::setIsa(isa))
+            {
+                continue;
+            }
+            double scan = scanNS(req, n);
+            printf("  %-6s scan %7.0f ns (%5.2f GB/s)  parse %7.0f ns\n", CharScan::isaName(isa), scan, req.size() / scan,
+                   parseNS(req, n));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+// 正则解析器(状态机之前的实现，见regex_request.h)和状态机解析器的对比: 每个请求的解析耗时
+// 请求是一个典型的浏览器页面请求和一个登录表单POST；缓冲区每轮写入一个请求后解析
+// 用法: bench_parser [状态机的请求数]，正则解析器只跑其1/100
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+
+#include "http/http_request.h"
+#include "regex_request.h"
+
+static const std::string PAGE =
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: 192.168.1.10:10000\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: en-US,en;q=0.9,zh-CN;q=0.8\r\n"
+    "Cookie: session=abcdef0123456789; theme=dark\r\n"
+    "\r\n";
+
+static const std::string LOGIN =
+    "POST /doLogin HTTP/1.1\r\n"
+    "Host: 192.168.1.10:10000\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "Content-Length: 33\r\n"
+    "\r\n"
+    "username=admin&password=123456%21";
+
+template <typename Parse>
+static double nsPerRequest(const std::string &req, long n, Parse parse)
+{
+    Buffer buff(8192);
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; ++i)
+    {
+        buff.initPtr();
+        buff.append(req);
+        if (!parse(buff))
+        {
+            fprintf(stderr, "parse failed\n");
+            exit(1);
+        }
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n;
+}
+
+static void run(const char *name, const std::string &req, long n)
+{
+    RegexHttpRequest regexReq;
+    double regexNS = nsPerRequest(req, n / 100 + 1, [&regexReq](Buffer &buff)
+                                  { regexReq.init(); return regexReq.parse(buff); });
+    HttpRequest stateReq;
+    double stateNS = nsPerRequest(req, n, [&stateReq](Buffer &buff)
+                                  { return stateReq.parse(buff) == HttpRequest::PARSE_COMPLETE; });
+    printf("%-6s %4zu bytes  regex %8.0f ns/req  state machine %6.0f ns/req  %6.1fx\n", name, req.size(), regexNS, stateNS,
+           regexNS / stateNS);
+}
+
+int main(int argc, char *argv[])
+{
+    spdlog::set_level(spdlog::level::warn);
+    long n = argc > 1 ? atol(argv[1]) : 1000000;
+    for (int round = 0; round < 3; ++round)
+    {
+        run("page", PAGE, n);
+        run("login", LOGIN, n);
+    }
+    return 0;
+}
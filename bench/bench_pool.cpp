@@ -0,0 +1,125 @@
+// 工作窃取线程池和互斥锁线程池的对比
+//  external: 若干个投递线程(相当于事件循环)不断投递约1us的小任务，统计吞吐和平均排队时间
+//  nested:   任务在工作线程中递归投递子任务(分治)，统计完成全部任务的时间
+// 工作线程数从1开始每次翻倍直到上限，一次运行得到两种线程池随线程数变化的曲线
+// 用法: bench_pool [最大工作线程数] [投递线程数]，默认64 2
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "threadpool/default_pool.h"
+
+static const char *NAMES[] = {"mutex", "stealing"};
+
+static void spin(uint32_t n)
+{
+    volatile uint32_t x = 0;
+    for (uint32_t i = 0; i < 300; ++i)
+    {
+        x = x + i * n;
+    }
+}
+
+static void external(int type, int threads, int producers)
+{
+    PoolOptions opts;
+    opts.type = type;
+    std::unique_ptr<Executor> pool(newThreadPool(threads, opts));
+    const long PER_PRODUCER = 200000;
+    std::atomic<long> posted(0), done(0);
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> posters;
+    for (int p = 0; p < producers; ++p)
+    {
+        posters.emplace_back([&pool, &posted, &done]()
+                             {
+            for (long i = 0; i < PER_PRODUCER; ++i)
+            {
+                pool->execute([&done, i]() { spin(static_cast<uint32_t>(i)); done.fetch_add(1, std::memory_order_relaxed); });
+                /* 积压太多时等一等，不让队列无限增长 */
+                while (posted.fetch_add(1, std::memory_order_relaxed) + 1 - done.load(std::memory_order_relaxed) > 8192)
+                {
+                    posted.fetch_sub(1, std::memory_order_relaxed);
+                    std::this_thread::yield();
+                }
+            } });
+    }
+    for (auto &t : posters)
+    {
+        t.join();
+    }
+    long total = PER_PRODUCER * producers;
+    while (done.load() < total)
+    {
+        std::this_thread::yield();
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    const LaneStats &lane = pool->stats().lanes[LANE_FAST];
+    printf("external %-8s threads=%-2d producers=%d  %9.0f tasks/s  avg wait %7.1f us  p99 <%lu us\n", NAMES[type],
+           threads, producers, total / sec, lane.waitNS.load() / 1000.0 / lane.tasks(),
+           static_cast<unsigned long>(lane.waitPercentileUS(0.99)));
+}
+
+struct Tree
+{
+    Executor *pool;
+    std::atomic<long> done{0};
+
+    void spawn(int depth)
+    {
+        spin(static_cast<uint32_t>(depth));
+        done.fetch_add(1, std::memory_order_relaxed);
+        if (depth > 0)
+        {
+            pool->execute([this, depth]() { spawn(depth - 1); });
+            pool->execute([this, depth]() { spawn(depth - 1); });
+        }
+    }
+};
+
+static void nested(int type, int threads)
+{
+    PoolOptions opts;
+    opts.type = type;
+    std::unique_ptr<Executor> pool(newThreadPool(threads, opts));
+    const int DEPTH = 19;
+    const long total = (1L << (DEPTH + 1)) - 1;
+    Tree tree;
+    tree.pool = pool.get();
+
+    auto t0 = std::chrono::steady_clock::now();
+    pool->execute([&tree]() { tree.spawn(DEPTH); });
+    while (tree.done.load() < total)
+    {
+        std::this_thread::yield();
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("nested   %-8s threads=%-2d              %9.0f tasks/s  (%ld tasks in %.0f ms)\n", NAMES[type], threads,
+           total / sec, total, sec * 1000);
+}
+
+int main(int argc, char *argv[])
+{
+    int maxThreads = argc > 1 ? atoi(argv[1]) : 64;
+    int producers = argc > 2 ? atoi(argv[2]) : 2;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        for (int type : {MUTEX_POOL, WORK_STEALING_POOL})
+        {
+            external(type, threads, producers);
+        }
+    }
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        for (int type : {MUTEX_POOL, WORK_STEALING_POOL})
+        {
+            nested(type, threads);
+        }
+    }
+    return 0;
+}
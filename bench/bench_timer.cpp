@@ -0,0 +1,82 @@
+// 时间轮和小根堆定时器的对比: 添加、随机续期、取消和到期处理每次操作的耗时
+// 用法: bench_timer [定时器数...]，默认10000 100000 1000000
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "timer/default_timer.h"
+
+static double nsSince(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+}
+
+template <typename Q>
+static void run(const char *name, int n)
+{
+    Q queue;
+    std::vector<TimerNode> nodes(n);
+    size_t fired = 0;
+    queue.setExpireCallBack([&fired](TimerNode *)
+                            { ++fired; });
+    std::mt19937 rng(1);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i)
+    {
+        nodes[i].id = i;
+        queue.add(&nodes[i], 60000);
+    }
+    double addNS = nsSince(t0) / n;
+
+    /* 每个请求都会续期所在连接的定时器，续期的连接是随机的 */
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < 4 * n; ++i)
+    {
+        queue.update(&nodes[rng() % n], 60000);
+    }
+    double updateNS = nsSince(t0) / (4.0 * n);
+
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i += 2)
+    {
+        queue.cancel(&nodes[i]);
+    }
+    double cancelNS = nsSince(t0) / ((n + 1) / 2);
+
+    /* 剩下的一半改为很快到期，等到期后一次处理 */
+    for (int i = 1; i < n; i += 2)
+    {
+        queue.update(&nodes[i], 1);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.tick();
+    t0 = std::chrono::steady_clock::now();
+    queue.handleExpired();
+    double expireNS = fired ? nsSince(t0) / fired : 0;
+
+    printf("%-6s n=%8d  add %6.1f ns  update %6.1f ns  cancel %6.1f ns  expire %6.1f ns (%zu fired)\n", name, n,
+           addNS, updateNS, cancelNS, expireNS, fired);
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; ++i)
+    {
+        sizes.push_back(atoi(argv[i]));
+    }
+    if (sizes.empty())
+    {
+        sizes = {10000, 100000, 1000000};
+    }
+    for (int n : sizes)
+    {
+        run<HeapTimer>("heap", n);
+        run<TimingWheel>("wheel", n);
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+#ifndef REGEX_REQUEST_H
+#define REGEX_REQUEST_H
+
+#include <algorithm>
+#include <regex>
+#include <string>
+#include <unordered_map>
+
+#include "buffer/buffer.h"
+
+// 状态机解析器之前的HttpRequest::parse，只保留解析部分，作为bench_parser的对比基准:
+// 每行复制成std::string，请求行和每个头部各构造并匹配一次std::regex，头部存入unordered_map
+class RegexHttpRequest
+{
+public:
+    enum PARSE_STATE
+    {
+        REQUEST_LINE,
+        HEADERS,
+        BODY,
+        FINISH,
+    };
+
+    RegexHttpRequest() { init(); }
+
+    void init()
+    {
+        method_ = path_ = version_ = body_ = "";
+        state_ = REQUEST_LINE;
+        header_.clear();
+    }
+
+    bool parse(Buffer &buff)
+    {
+        const char CRLF[] = "\r\n";
+        if (buff.readableBytes() <= 0)
+        {
+            return false;
+        }
+        while (buff.readableBytes() && state_ != FINISH)
+        {
+            const char *lineEnd = std::search(buff.curReadPtr(), buff.curWritePtrConst(), CRLF, CRLF + 2);
+            std::string line(buff.curReadPtr(), lineEnd);
+            switch (state_)
+            {
+            case REQUEST_LINE:
+                if (!parseRequestLine_(line))
+                {
+                    return false;
+                }
+                break;
+            case HEADERS:
+                parseRequestHeader_(line);
+                if (buff.readableBytes() <= 2)
+                {
+                    state_ = FINISH;
+                }
+                break;
+            case BODY:
+                body_ = line;
+                state_ = FINISH;
+                break;
+            default:
+                break;
+            }
+            if (lineEnd == buff.curWritePtr())
+            {
+                break;
+            }
+            buff.updateReadPtrUntilEnd(lineEnd + 2);
+        }
+        return true;
+    }
+
+    const std::string &path() const { return path_; }
+    const std::string &body() const { return body_; }
+    size_t headerCount() const { return header_.size(); }
+
+private:
+    bool parseRequestLine_(const std::string &line)
+    {
+        std::regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
+        std::smatch subMatch;
+        if (regex_match(line, subMatch, patten))
+        {
+            method_ = subMatch[1];
+            path_ = subMatch[2];
+            version_ = subMatch[3];
+            state_ = HEADERS;
+            return true;
+        }
+        return false;
+    }
+
+    void parseRequestHeader_(const std::string &line)
+    {
+        std::regex patten("^([^:]*): ?(.*)$");
+        std::smatch subMatch;
+        if (regex_match(line, subMatch, patten))
+        {
+            header_[subMatch[1]] = subMatch[2];
+        }
+        else
+        {
+            state_ = BODY;
+        }
+    }
+
+    PARSE_STATE state_;
+    std::string method_, path_, version_, body_;
+    std::unordered_map<std::string, std::string> header_;
+};
+
+#endif // REGEX_REQUEST_H
@@ -34,6 +34,8 @@ public:
     void updateReadPtrUntilEnd(const char *end); // 将读指针直接更新到指定位置
     // 更新写指针
     void updateWritePtr(size_t len);
+    // 删除可读区域中[begin, end)的数据，之后的数据前移
+    void erase(const char *begin, const char *end);
     // 将读指针和写指针初始化
     void initPtr();
 
@@ -45,8 +47,8 @@ public:
     void append(const void *data, size_t len);
     void append(const Buffer &buffer);
 
-    // IO操作的读与写
-    ssize_t readFd(int fd, int *Errno);
+    // IO操作的读与写，readFd最多读入maxLen字节
+    ssize_t readFd(int fd, int *Errno, size_t maxLen = SIZE_MAX);
     ssize_t writeFd(int fd, int *Errno);
 
     // 将缓冲区的数据转化为字符串
@@ -128,6 +130,13 @@ void Buffer::updateWritePtr(size_t len)
     _writePos += len;
 }
 
+void Buffer::erase(const char *begin, const char *end)
+{
+    assert(begin >= curReadPtr() && begin <= end && end <= curWritePtrConst());
+    std::copy(end, curWritePtrConst(), begin_() + (begin - begin_()));
+    _writePos -= end - begin;
+}
+
 void Buffer::initPtr()
 {
     bzero(&_buffer[0], _buffer.size());
@@ -185,21 +194,25 @@ void Buffer::append(const Buffer &buffer)
     append(buffer.curReadPtr(), buffer.readableBytes());
 }
 
-ssize_t Buffer::readFd(int fd, int *Errno)
+ssize_t Buffer::readFd(int fd, int *Errno, size_t maxLen)
 {
     char buff[65535]; // 暂时的缓冲区
     struct iovec iov[2];
-    const size_t writable = writeableBytes();
+    const size_t writable = std::min(writeableBytes(), maxLen);
 
     iov[0].iov_base = begin_() + _writePos;
     iov[0].iov_len = writable;
     iov[1].iov_base = buff;
-    iov[1].iov_len = sizeof(buff);
+    iov[1].iov_len = std::min(sizeof(buff), maxLen - writable);
 
     const ssize_t len = readv(fd, iov, 2);
     if (len < 0)
     {
-        spdlog::error("fd:{}===>Read data unsuccessfully.", fd);
+        /* ET模式下每次读取都以EAGAIN结束，不是错误 */
+        if (errno != EAGAIN)
+        {
+            spdlog::error("fd:{}===>Read data unsuccessfully.", fd);
+        }
         *Errno = errno;
     }
     else if (static_cast<size_t>(len) <= writable)
@@ -208,7 +221,7 @@ ssize_t Buffer::readFd(int fd, int *Errno)
     }
     else
     {
-        _writePos = _buffer.size();
+        _writePos += writable;
         append(buff, len - writable);
     }
     return len;
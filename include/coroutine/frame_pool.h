@@ -0,0 +1,131 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+// 协程帧的内存池，每个事件循环一个，只由所属线程使用
+// 按GRANULE字节分级，每级一条空闲链表，释放的帧挂回链表供下次复用，超过MAX_SIZE的直接使用operator new。
+// 每块前面有一个HEADER字节的头记录所属的池，因此在没有设置当前池的线程中创建的帧也能正确释放；
+// 从池中分配的帧必须在所属线程中释放
+class FramePool
+{
+public:
+    static const size_t GRANULE = 64;
+    static const size_t MAX_SIZE = 4096;
+    static const size_t HEADER = 16; // 保持帧按16字节对齐
+
+    FramePool();
+    ~FramePool();
+
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+
+    // 从当前线程的池分配，没有设置时使用operator new
+    static void *allocateFrame(size_t size);
+    static void deallocateFrame(void *frame, size_t size);
+
+    // 设置当前线程使用的池，由事件循环线程启动时调用
+    static void setCurrent(FramePool *pool);
+    static FramePool *current();
+
+    uint64_t allocations() const; // 分配次数
+    uint64_t reused() const;      // 其中从空闲链表取得的次数
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+    static const size_t CLASSES = MAX_SIZE / GRANULE;
+
+    void *allocate_(size_t cls);
+    void release_(void *block, size_t cls);
+
+    FreeBlock *free_[CLASSES];
+    uint64_t allocations_;
+    uint64_t reused_;
+
+    static thread_local FramePool *current_;
+};
+
+thread_local FramePool *FramePool::current_ = nullptr;
+
+FramePool::FramePool() : free_(), allocations_(0), reused_(0) {}
+
+FramePool::~FramePool()
+{
+    for (size_t i = 0; i < CLASSES; ++i)
+    {
+        while (free_[i])
+        {
+            FreeBlock *block = free_[i];
+            free_[i] = block->next;
+            ::operator delete(block);
+        }
+    }
+}
+
+void FramePool::setCurrent(FramePool *pool)
+{
+    current_ = pool;
+}
+
+FramePool *FramePool::current()
+{
+    return current_;
+}
+
+uint64_t FramePool::allocations() const
+{
+    return allocations_;
+}
+
+uint64_t FramePool::reused() const
+{
+    return reused_;
+}
+
+void *FramePool::allocateFrame(size_t size)
+{
+    size_t total = size + HEADER;
+    FramePool *pool = total <= MAX_SIZE ? current_ : nullptr;
+    char *block = static_cast<char *>(pool ? pool->allocate_((total - 1) / GRANULE) : ::operator new(total));
+    *reinterpret_cast<FramePool **>(block) = pool;
+    return block + HEADER;
+}
+
+void FramePool::deallocateFrame(void *frame, size_t size)
+{
+    char *block = static_cast<char *>(frame) - HEADER;
+    FramePool *pool = *reinterpret_cast<FramePool **>(block);
+    if (pool)
+    {
+        pool->release_(block, (size + HEADER - 1) / GRANULE);
+        return;
+    }
+    ::operator delete(block);
+}
+
+void *FramePool::allocate_(size_t cls)
+{
+    ++allocations_;
+    FreeBlock *block = free_[cls];
+    if (block)
+    {
+        ++reused_;
+        free_[cls] = block->next;
+        return block;
+    }
+    return ::operator new((cls + 1) * GRANULE);
+}
+
+void FramePool::release_(void *block, size_t cls)
+{
+    FreeBlock *free = static_cast<FreeBlock *>(block);
+    free->next = free_[cls];
+    free_[cls] = free;
+}
+
+#endif // FRAME_POOL_H
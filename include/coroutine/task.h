@@ -0,0 +1,161 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+#include "../spdlog/spdlog.h"
+#include "frame_pool.h"
+
+template <typename T = void>
+class Task;
+
+// 所有Task协程共用的promise部分: 帧从当前线程的FramePool分配；
+// 结束时对称转移回等待它的协程，没有等待者(最外层)时停在final_suspend，由持有者销毁
+class TaskPromiseBase
+{
+public:
+    static void *operator new(size_t size)
+    {
+        return FramePool::allocateFrame(size);
+    }
+
+    static void operator delete(void *frame, size_t size)
+    {
+        FramePool::deallocateFrame(frame, size);
+    }
+
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            TaskPromiseBase &promise = h.promise();
+            if (promise.continuation_)
+            {
+                return promise.continuation_;
+            }
+            if (promise.exception_)
+            {
+                spdlog::error("coroutine===>unhandled exception in top-level task");
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { exception_ = std::current_exception(); }
+
+    void setContinuation(std::coroutine_handle<> continuation) { continuation_ = continuation; }
+
+    void rethrowIfFailed()
+    {
+        if (exception_)
+        {
+            std::rethrow_exception(exception_);
+        }
+    }
+
+private:
+    std::coroutine_handle<> continuation_;
+    std::exception_ptr exception_;
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase
+{
+public:
+    Task<T> get_return_object();
+    void return_value(T value) { value_ = std::move(value); }
+
+    T result()
+    {
+        rethrowIfFailed();
+        return std::move(value_);
+    }
+
+private:
+    T value_{};
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase
+{
+public:
+    Task<void> get_return_object();
+    void return_void() {}
+    void result() { rethrowIfFailed(); }
+};
+
+// 惰性启动的协程: 创建后不执行，co_await时才开始运行，结束后恢复等待者；
+// 对象销毁时销毁协程帧，因此等待链上的帧随最外层一起释放。T需要可以默认构造
+template <typename T>
+class Task
+{
+public:
+    typedef TaskPromise<T> promise_type;
+    typedef std::coroutine_handle<promise_type> Handle;
+
+    Task() noexcept {}
+    explicit Task(Handle handle) noexcept : handle_(handle) {}
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task() { reset(); }
+
+    bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle_.promise().setContinuation(awaiting);
+        return handle_;
+    }
+
+    T await_resume() { return handle_.promise().result(); }
+
+    // 交出协程帧的所有权，由调用者resume和destroy，用于最外层的协程
+    Handle release() noexcept { return std::exchange(handle_, nullptr); }
+
+    void reset()
+    {
+        if (handle_)
+        {
+            handle_.destroy();
+            handle_ = nullptr;
+        }
+    }
+
+private:
+    Handle handle_;
+};
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object()
+{
+    return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object()
+{
+    return Task<void>(Task<void>::Handle::from_promise(*this));
+}
+
+#endif // TASK_H
@@ -0,0 +1,25 @@
+#ifndef DEFAULT_POLLER_H
+#define DEFAULT_POLLER_H
+
+#include "../spdlog/spdlog.h"
+#include "poller.h"
+#include "epoller.h"
+#include "uring_poller.h"
+
+// 按照类型创建Poller，io_uring初始化失败时自动退回epoll
+Poller *newPoller(int type, int maxEvents = 1024)
+{
+    if (type == URING_POLLER)
+    {
+        UringPoller *poller = new UringPoller(maxEvents);
+        if (poller->isValid())
+        {
+            return poller;
+        }
+        delete poller;
+        spdlog::warn("io_uring setup failed, fall back to epoll.");
+    }
+    return new Epoller(maxEvents);
+}
+
+#endif // DEFAULT_POLLER_H
@@ -10,23 +10,26 @@
 #include<vector>
 #include<errno.h>
 
-class Epoller {
+#include "poller.h"
+
+class Epoller final : public Poller {
 public:
     explicit Epoller(int maxEvents=1024);
-    ~Epoller();
+    ~Epoller() override;
     
     //将描述符fd加入epoll监控
-    bool addFd(int fd, uint32_t events);
+    bool addFd(int fd, uint32_t events, void *ptr) override;
     //修改描述符fd对应的事件
-    bool modFd(int fd, uint32_t events);
+    bool modFd(int fd, uint32_t events, void *ptr) override;
     //将描述符fd移除epoll的监控
-    bool delFd(int fd);
+    bool delFd(int fd) override;
     //用于返回监控的结果，成功时返回就绪的文件描述符的个数
-    int wait(int timewait = -1);
-    //获取fd的函数
-    int getEventFd(size_t i) const;
+    int wait(int timewait = -1) override;
+    //获取注册时附带的指针
+    void *getEventPtr(size_t i) const override;
     //获取events的函数
-    uint32_t getEvents(size_t i) const;
+    uint32_t getEvents(size_t i) const override;
+    const char *name() const override { return "epoll"; }
     //获取epollerFd_
     int getEpollFd() const;
 
@@ -46,19 +49,19 @@ Epoller::~Epoller()
     close(epollerFd_);
 }
 
-bool Epoller::addFd(int fd, uint32_t events)
+bool Epoller::addFd(int fd, uint32_t events, void *ptr)
 {
     epoll_event ev = {0};
-    ev.data.fd = fd;
+    ev.data.ptr = ptr;
     ev.events = events;
     return 0 == epoll_ctl(epollerFd_, EPOLL_CTL_ADD, fd, &ev);
 }
 
-bool Epoller::modFd(int fd, uint32_t events)
+bool Epoller::modFd(int fd, uint32_t events, void *ptr)
 {
 
     epoll_event ev = {0};
-    ev.data.fd = fd;
+    ev.data.ptr = ptr;
     ev.events = events;
     return 0 == epoll_ctl(epollerFd_, EPOLL_CTL_MOD, fd, &ev);
 }
@@ -74,11 +77,11 @@ int Epoller::wait(int timewait)
 {
     return epoll_wait(epollerFd_, &events_[0], static_cast<int>(events_.size()), timewait);
 }
-// 获取fd的函数
-int Epoller::getEventFd(size_t i) const
+// 获取注册时附带的指针
+void *Epoller::getEventPtr(size_t i) const
 {
 
-    return events_[i].data.fd;
+    return events_[i].data.ptr;
 }
 // 获取events的函数
 uint32_t Epoller::getEvents(size_t i) const
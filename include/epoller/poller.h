@@ -0,0 +1,49 @@
+#ifndef POLLER_H
+#define POLLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 可选的IO多路复用后端
+enum POLLER_TYPE
+{
+    EPOLL_POLLER = 0,
+    URING_POLLER,
+};
+
+// IO多路复用的抽象接口，事件掩码统一使用EPOLLIN/EPOLLOUT/EPOLLONESHOT等epoll的定义
+// 注册时附带的ptr会在事件就绪时原样返回，分发时不需要再用fd查找连接
+class Poller
+{
+public:
+    virtual ~Poller() = default;
+
+    //将描述符fd加入监控
+    virtual bool addFd(int fd, uint32_t events, void *ptr) = 0;
+    //修改描述符fd对应的事件
+    virtual bool modFd(int fd, uint32_t events, void *ptr) = 0;
+    //将描述符fd移除监控
+    virtual bool delFd(int fd) = 0;
+    //用于返回监控的结果，成功时返回就绪的文件描述符的个数
+    virtual int wait(int timewait = -1) = 0;
+    //获取注册时附带的指针
+    virtual void *getEventPtr(size_t i) const = 0;
+    //获取events的函数
+    virtual uint32_t getEvents(size_t i) const = 0;
+    //后端名称，用于日志
+    virtual const char *name() const = 0;
+
+    // 以下是完成式后端(io_uring)才有的能力，默认不支持，loop退回到accept4/read
+    //是否支持addAcceptor/addReceiver
+    virtual bool completionIo() const { return false; }
+    //由后端accept监听socket，新连接用takeAccepted取走，有新连接时以ptr报告EPOLLIN
+    virtual bool addAcceptor(int /*fd*/, void * /*ptr*/) { return false; }
+    //取走最多n个已经accept的连接，返回取到的个数
+    virtual size_t takeAccepted(int * /*fds*/, size_t /*n*/) { return 0; }
+    //由后端接收fd上的数据，events中除EPOLLIN以外的事件照常监控，移除同样用delFd
+    virtual bool addReceiver(int /*fd*/, uint32_t /*events*/, void * /*ptr*/) { return false; }
+    //第i个事件附带的数据，只在下一次wait()之前有效，返回数据长度
+    virtual size_t getEventData(size_t /*i*/, const char ** /*data*/) const { return 0; }
+};
+
+#endif // POLLER_H
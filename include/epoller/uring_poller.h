@@ -0,0 +1,732 @@
+#ifndef URING_POLLER_H
+#define URING_POLLER_H
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+
+#include "poller.h"
+
+// 基于io_uring的IORING_OP_POLL_ADD实现的Poller
+// addFd/modFd/delFd只是往SQ里放请求，由下一次wait()和等待一起通过一次io_uring_enter提交，
+// 把每个请求的epoll_ctl + epoll_wait合并成一次系统调用。
+// 其他线程在loop阻塞等待时修改事件，会立即提交，避免loop错过事件。
+// 带EPOLLET且不带EPOLLONESHOT的注册使用multishot poll，与epoll的ET语义一致。
+// 内核支持provided buffer ring(6.0+)时还提供完成式的accept和接收:
+// addAcceptor用multishot accept取代监听socket上的poll + accept4，
+// addReceiver用multishot recv把数据直接收进注册给内核的缓冲区环，事件带着数据返回，loop不再调用read；
+// 缓冲区在下一次wait()时归还给内核，缓冲区用完(-ENOBUFS)而停止的recv也在那时重新提交。
+// 发送还没有走io_uring: 响应仍由loop线程同步writev，发不完时等multishot poll的EPOLLOUT。
+// 改成链接的IORING_OP_WRITEV(或SEND + SPLICE发送文件)需要iovec、写缓冲区和文件映射在请求完成前保持有效，
+// 连接关闭也要像busy一样推迟到完成事件之后，留作后续工作。
+class UringPoller final : public Poller
+{
+public:
+    explicit UringPoller(int maxEvents = 1024);
+    ~UringPoller() override;
+
+    // io_uring初始化是否成功，失败时应退回到epoll
+    bool isValid() const;
+
+    bool addFd(int fd, uint32_t events, void *ptr) override;
+    bool modFd(int fd, uint32_t events, void *ptr) override;
+    bool delFd(int fd) override;
+    int wait(int timewait = -1) override;
+    void *getEventPtr(size_t i) const override;
+    uint32_t getEvents(size_t i) const override;
+    const char *name() const override { return "io_uring"; }
+
+    bool completionIo() const override;
+    bool addAcceptor(int fd, void *ptr) override;
+    size_t takeAccepted(int *fds, size_t n) override;
+    bool addReceiver(int fd, uint32_t events, void *ptr) override;
+    size_t getEventData(size_t i, const char **data) const override;
+
+    static const unsigned RECV_BUFFERS = 256;      // 缓冲区环的大小，必须是2的幂
+    static const unsigned RECV_BUFFER_SIZE = 4096; // 每个缓冲区的大小，一般足够放下一个请求
+
+private:
+    // 每个fd当前注册的事件
+    struct Interest
+    {
+        uint32_t events; // 注册的事件掩码(接收者不含EPOLLIN)
+        void *ptr;       // 注册时附带的指针
+        uint32_t gen;    // 每次重新注册递增，用于丢弃过期的完成事件
+        uint32_t opGen;  // accept/recv请求的generation，只在add和delFd时递增
+        bool active;     // 是否处于监控中
+        bool armed;      // 内核中是否有未完成的poll请求
+        uint8_t op;      // OP_POLL，或者由后端accept/接收
+        bool opArmed;    // 内核中是否有未完成的accept/recv请求
+    };
+
+    // 事件附带的数据，指向缓冲区环中的缓冲区
+    struct EventData
+    {
+        const char *data;
+        uint32_t len;
+    };
+
+    // user_data的高2位是请求类型，接着30位generation，低32位fd
+    enum OP
+    {
+        OP_POLL = 0,
+        OP_ACCEPT,
+        OP_RECV,
+    };
+
+    static bool isMultishot_(uint32_t events) { return (events & EPOLLET) && !(events & EPOLLONESHOT); }
+
+    static const uint64_t REMOVE_TAG = ~0ULL; // POLL_REMOVE和ASYNC_CANCEL自身的完成事件
+    static const uint32_t GEN_MASK = (1u << 30) - 1;
+    static const int RECV_GROUP = 0; // 缓冲区环的buffer group id
+
+    bool setup_(unsigned entries);
+    bool setupBuffers_();
+    int enter_(unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argSize);
+
+    // 以下函数需要持有mutex_
+    io_uring_sqe *getSqe_();
+    unsigned unsubmitted_() const;
+    void flushIfWaiting_();
+    void armPoll_(int fd);
+    void removePoll_(int fd);
+    void armOp_(int fd); // 提交accept或recv请求
+    void cancelOp_(int fd);
+    Interest &interest_(int fd);
+    void provideBuffer_(uint16_t bid);
+    void recycle_(); // 归还上一轮交出去的缓冲区，重新提交停止的recv
+    bool reapAccept_(const io_uring_cqe &cqe, int fd, uint32_t gen);
+    bool reapRecv_(const io_uring_cqe &cqe, int fd, uint32_t gen, int cnt);
+    int reap_();
+
+    static uint64_t encode_(int fd, uint32_t gen, int op = OP_POLL)
+    {
+        return (static_cast<uint64_t>(op) << 62) | (static_cast<uint64_t>(gen & GEN_MASK) << 32) | static_cast<uint32_t>(fd);
+    }
+
+    int ringFd_;
+    void *sqRingPtr_;
+    void *cqRingPtr_;
+    size_t sqRingSize_;
+    size_t cqRingSize_;
+    io_uring_sqe *sqes_;
+    size_t sqesSize_;
+
+    unsigned *sqHead_, *sqTail_, *sqMask_, *sqArray_;
+    unsigned *cqHead_, *cqTail_, *cqMask_;
+    io_uring_cqe *cqes_;
+    unsigned sqLocalTail_;
+
+    std::mutex mutex_;
+    bool waiting_; // loop是否阻塞在io_uring_enter中
+    std::vector<Interest> interests_; // 以fd为下标
+    std::vector<struct epoll_event> events_; //就绪的事件
+    std::vector<EventData> eventData_;       //与events_一一对应
+    int eventCnt_;                           //本轮就绪的事件数
+
+    io_uring_buf_ring *bufRing_; // 缓冲区环，之后紧跟着各个缓冲区，为空时不支持完成式的accept和接收
+    char *bufBase_;
+    size_t bufSize_;
+    uint16_t bufTail_;
+    std::vector<uint16_t> usedBufs_; // 本轮交给loop的缓冲区
+    std::vector<int> rearm_;         // 因缓冲区用完而停止recv的fd
+    std::vector<int> accepted_;      // 已经accept、等待loop取走的连接
+};
+
+UringPoller::UringPoller(int maxEvents)
+    : ringFd_(-1), sqRingPtr_(MAP_FAILED), cqRingPtr_(MAP_FAILED), sqRingSize_(0), cqRingSize_(0),
+      sqes_(static_cast<io_uring_sqe *>(MAP_FAILED)), sqesSize_(0), sqLocalTail_(0), waiting_(false), events_(maxEvents),
+      eventData_(maxEvents), eventCnt_(0), bufRing_(nullptr), bufBase_(nullptr), bufSize_(0), bufTail_(0)
+{
+    if (!setup_(static_cast<unsigned>(maxEvents)) && ringFd_ >= 0)
+    {
+        close(ringFd_);
+        ringFd_ = -1;
+    }
+    if (ringFd_ >= 0)
+    {
+        setupBuffers_();
+    }
+}
+
+UringPoller::~UringPoller()
+{
+    if (sqes_ != MAP_FAILED)
+        munmap(sqes_, sqesSize_);
+    if (cqRingPtr_ != MAP_FAILED && cqRingPtr_ != sqRingPtr_)
+        munmap(cqRingPtr_, cqRingSize_);
+    if (sqRingPtr_ != MAP_FAILED)
+        munmap(sqRingPtr_, sqRingSize_);
+    if (ringFd_ >= 0)
+        close(ringFd_);
+    /* 关闭ring之后内核不会再写缓冲区 */
+    if (bufRing_)
+        munmap(bufRing_, bufSize_);
+    for (int fd : accepted_)
+        close(fd);
+}
+
+bool UringPoller::isValid() const
+{
+    return ringFd_ >= 0;
+}
+
+bool UringPoller::setup_(unsigned entries)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    ringFd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+    if (ringFd_ < 0)
+    {
+        return false;
+    }
+    // 需要带超时的等待(EXT_ARG)以及CQ不丢事件(NODROP)
+    if (!(p.features & IORING_FEAT_EXT_ARG) || !(p.features & IORING_FEAT_NODROP))
+    {
+        return false;
+    }
+
+    sqRingSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqRingSize_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (cqRingSize_ > sqRingSize_)
+            sqRingSize_ = cqRingSize_;
+        cqRingSize_ = sqRingSize_;
+    }
+
+    sqRingPtr_ = mmap(0, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    if (sqRingPtr_ == MAP_FAILED)
+        return false;
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        cqRingPtr_ = sqRingPtr_;
+    }
+    else
+    {
+        cqRingPtr_ = mmap(0, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+        if (cqRingPtr_ == MAP_FAILED)
+            return false;
+    }
+
+    sqesSize_ = p.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(mmap(0, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED)
+        return false;
+
+    char *sq = static_cast<char *>(sqRingPtr_);
+    sqHead_ = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    sqMask_ = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    sqArray_ = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+    sqLocalTail_ = *sqTail_;
+
+    char *cq = static_cast<char *>(cqRingPtr_);
+    cqHead_ = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+    cqMask_ = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+    return true;
+}
+
+bool UringPoller::setupBuffers_()
+{
+    // multishot recv要求6.0+，比provided buffer ring(5.19)晚一个版本，内核不会拒绝注册，只能按版本判断
+    struct utsname u;
+    int major = 0, minor = 0;
+    if (uname(&u) < 0 || sscanf(u.release, "%d.%d", &major, &minor) != 2 || major < 6)
+        return false;
+
+    // 环本身占一页，缓冲区紧随其后，一次mmap得到页对齐的内存
+    size_t ringSize = RECV_BUFFERS * sizeof(io_uring_buf);
+    bufSize_ = ringSize + static_cast<size_t>(RECV_BUFFERS) * RECV_BUFFER_SIZE;
+    void *mem = mmap(0, bufSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        return false;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(mem);
+    reg.ring_entries = RECV_BUFFERS;
+    reg.bgid = RECV_GROUP;
+    if (syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        /* 6.0之前的内核 */
+        munmap(mem, bufSize_);
+        return false;
+    }
+    bufRing_ = static_cast<io_uring_buf_ring *>(mem);
+    bufBase_ = static_cast<char *>(mem) + ringSize;
+    for (unsigned bid = 0; bid < RECV_BUFFERS; ++bid)
+    {
+        provideBuffer_(static_cast<uint16_t>(bid));
+    }
+    __atomic_store_n(&bufRing_->tail, bufTail_, __ATOMIC_RELEASE);
+    return true;
+}
+
+int UringPoller::enter_(unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argSize)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags, arg, argSize));
+}
+
+unsigned UringPoller::unsubmitted_() const
+{
+    return sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+}
+
+io_uring_sqe *UringPoller::getSqe_()
+{
+    // SQ已满时先把积压的请求提交掉
+    if (unsubmitted_() > *sqMask_)
+    {
+        enter_(unsubmitted_(), 0, 0, nullptr, 0);
+        if (unsubmitted_() > *sqMask_)
+            return nullptr;
+    }
+    unsigned idx = sqLocalTail_ & *sqMask_;
+    io_uring_sqe *sqe = &sqes_[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray_[idx] = idx;
+    return sqe;
+}
+
+void UringPoller::flushIfWaiting_()
+{
+    // 发布新的SQ尾部；loop正在等待时由当前线程立即提交
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+    if (waiting_)
+    {
+        enter_(unsubmitted_(), 0, 0, nullptr, 0);
+    }
+}
+
+void UringPoller::armPoll_(int fd)
+{
+    Interest &in = interests_[fd];
+    io_uring_sqe *sqe = getSqe_();
+    if (!sqe)
+        return;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    // 一次性的poll请求对应ONESHOT以及需要重新注册来模拟的LT，常驻的ET使用multishot
+    sqe->poll32_events = in.events & ~(EPOLLET | EPOLLONESHOT);
+    if (isMultishot_(in.events))
+    {
+        sqe->len = IORING_POLL_ADD_MULTI;
+    }
+    sqe->user_data = encode_(fd, in.gen);
+    ++sqLocalTail_;
+    in.armed = true;
+}
+
+void UringPoller::removePoll_(int fd)
+{
+    Interest &in = interests_[fd];
+    if (!in.armed)
+        return;
+    io_uring_sqe *sqe = getSqe_();
+    if (!sqe)
+        return;
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = encode_(fd, in.gen);
+    sqe->user_data = REMOVE_TAG;
+    ++sqLocalTail_;
+    in.armed = false;
+}
+
+void UringPoller::armOp_(int fd)
+{
+    Interest &in = interests_[fd];
+    io_uring_sqe *sqe = getSqe_();
+    if (!sqe)
+        return;
+    sqe->fd = fd;
+    if (in.op == OP_ACCEPT)
+    {
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    }
+    else
+    {
+        /* 每次完成由内核从缓冲区环中挑一个缓冲区 */
+        sqe->opcode = IORING_OP_RECV;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = RECV_GROUP;
+    }
+    sqe->user_data = encode_(fd, in.opGen, in.op);
+    ++sqLocalTail_;
+    in.opArmed = true;
+}
+
+void UringPoller::cancelOp_(int fd)
+{
+    Interest &in = interests_[fd];
+    if (!in.opArmed)
+        return;
+    io_uring_sqe *sqe = getSqe_();
+    if (!sqe)
+        return;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = encode_(fd, in.opGen, in.op);
+    sqe->user_data = REMOVE_TAG;
+    ++sqLocalTail_;
+    in.opArmed = false;
+}
+
+UringPoller::Interest &UringPoller::interest_(int fd)
+{
+    if (static_cast<size_t>(fd) >= interests_.size())
+    {
+        interests_.resize(fd + 1, {0, nullptr, 0, 0, false, false, OP_POLL, false});
+    }
+    return interests_[fd];
+}
+
+void UringPoller::provideBuffer_(uint16_t bid)
+{
+    // C++下头文件中的柔性数组bufs会被挪到偏移8处，按内核的布局直接把环当作io_uring_buf数组
+    io_uring_buf *buf = reinterpret_cast<io_uring_buf *>(bufRing_) + (bufTail_ & (RECV_BUFFERS - 1));
+    buf->addr = reinterpret_cast<uint64_t>(bufBase_ + static_cast<size_t>(bid) * RECV_BUFFER_SIZE);
+    buf->len = RECV_BUFFER_SIZE;
+    buf->bid = bid;
+    ++bufTail_;
+}
+
+void UringPoller::recycle_()
+{
+    // 上一轮的数据loop已经处理完，缓冲区一次性发布给内核
+    if (!usedBufs_.empty())
+    {
+        for (uint16_t bid : usedBufs_)
+        {
+            provideBuffer_(bid);
+        }
+        __atomic_store_n(&bufRing_->tail, bufTail_, __ATOMIC_RELEASE);
+        usedBufs_.clear();
+    }
+    for (int fd : rearm_)
+    {
+        Interest &in = interests_[fd];
+        if (in.active && in.op == OP_RECV && !in.opArmed)
+        {
+            armOp_(fd);
+        }
+    }
+    rearm_.clear();
+}
+
+bool UringPoller::completionIo() const
+{
+    return bufRing_ != nullptr;
+}
+
+bool UringPoller::addFd(int fd, uint32_t events, void *ptr)
+{
+    if (fd < 0 || !isValid())
+        return false;
+    std::lock_guard<std::mutex> lk(mutex_);
+    Interest &in = interest_(fd);
+    if (in.active)
+        return false;
+    in.events = events;
+    in.ptr = ptr;
+    in.active = true;
+    in.op = OP_POLL;
+    ++in.gen;
+    armPoll_(fd);
+    flushIfWaiting_();
+    return true;
+}
+
+bool UringPoller::addAcceptor(int fd, void *ptr)
+{
+    if (fd < 0 || !completionIo())
+        return false;
+    std::lock_guard<std::mutex> lk(mutex_);
+    Interest &in = interest_(fd);
+    if (in.active)
+        return false;
+    in.events = 0;
+    in.ptr = ptr;
+    in.active = true;
+    in.op = OP_ACCEPT;
+    ++in.gen;
+    ++in.opGen;
+    armOp_(fd);
+    flushIfWaiting_();
+    return true;
+}
+
+size_t UringPoller::takeAccepted(int *fds, size_t n)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    n = std::min(n, accepted_.size());
+    std::copy(accepted_.begin(), accepted_.begin() + n, fds);
+    accepted_.erase(accepted_.begin(), accepted_.begin() + n);
+    return n;
+}
+
+bool UringPoller::addReceiver(int fd, uint32_t events, void *ptr)
+{
+    if (fd < 0 || !completionIo())
+        return false;
+    std::lock_guard<std::mutex> lk(mutex_);
+    Interest &in = interest_(fd);
+    if (in.active)
+        return false;
+    // 读和对端关闭由recv报告，其余事件(EPOLLOUT)仍然用poll监控
+    in.events = events & ~(EPOLLIN | EPOLLRDHUP);
+    in.ptr = ptr;
+    in.active = true;
+    in.op = OP_RECV;
+    ++in.gen;
+    ++in.opGen;
+    armOp_(fd);
+    if (in.events & ~(EPOLLET | EPOLLONESHOT))
+    {
+        armPoll_(fd);
+    }
+    flushIfWaiting_();
+    return true;
+}
+
+size_t UringPoller::getEventData(size_t i, const char **data) const
+{
+    *data = eventData_[i].data;
+    return eventData_[i].len;
+}
+
+bool UringPoller::modFd(int fd, uint32_t events, void *ptr)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (fd < 0 || static_cast<size_t>(fd) >= interests_.size() || !interests_[fd].active)
+        return false;
+    Interest &in = interests_[fd];
+    removePoll_(fd);
+    in.events = in.op == OP_RECV ? (events & ~(EPOLLIN | EPOLLRDHUP)) : events;
+    in.ptr = ptr;
+    ++in.gen;
+    if (in.op == OP_POLL || (in.events & ~(EPOLLET | EPOLLONESHOT)))
+        armPoll_(fd);
+    flushIfWaiting_();
+    return true;
+}
+
+bool UringPoller::delFd(int fd)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (fd < 0 || static_cast<size_t>(fd) >= interests_.size() || !interests_[fd].active)
+        return false;
+    Interest &in = interests_[fd];
+    removePoll_(fd);
+    cancelOp_(fd);
+    if (in.op == OP_RECV)
+    {
+        /* 本轮还没分发的事件属于这个连接，fd可能在本轮被重新accept，不能再交给新连接 */
+        for (int i = 0; i < eventCnt_; ++i)
+        {
+            if (events_[i].data.ptr == in.ptr)
+            {
+                events_[i].events = 0;
+                eventData_[i].len = 0;
+            }
+        }
+    }
+    else if (in.op == OP_ACCEPT)
+    {
+        for (int afd : accepted_)
+            close(afd);
+        accepted_.clear();
+    }
+    in.active = false;
+    in.op = OP_POLL;
+    ++in.gen;
+    ++in.opGen;
+    flushIfWaiting_();
+    return true;
+}
+
+bool UringPoller::reapAccept_(const io_uring_cqe &cqe, int fd, uint32_t gen)
+{
+    Interest &in = interests_[fd];
+    if (!in.active || in.op != OP_ACCEPT || (in.opGen & GEN_MASK) != gen)
+    {
+        if (cqe.res >= 0)
+            close(cqe.res); /* 取消之前已经accept的连接 */
+        return false;
+    }
+    if (!(cqe.flags & IORING_CQE_F_MORE))
+    {
+        in.opArmed = false;
+        armOp_(fd); /* multishot因出错等原因停止，下一次wait时重新提交 */
+    }
+    if (cqe.res < 0)
+        return false;
+    accepted_.push_back(cqe.res);
+    return true;
+}
+
+bool UringPoller::reapRecv_(const io_uring_cqe &cqe, int fd, uint32_t gen, int cnt)
+{
+    Interest &in = interests_[fd];
+    bool hasBuf = cqe.flags & IORING_CQE_F_BUFFER;
+    uint16_t bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    if (hasBuf)
+    {
+        usedBufs_.push_back(bid);
+    }
+    if (!in.active || in.op != OP_RECV || (in.opGen & GEN_MASK) != gen || cqe.res == -ECANCELED)
+        return false;
+
+    bool more = cqe.flags & IORING_CQE_F_MORE;
+    if (!more)
+        in.opArmed = false;
+    eventData_[cnt] = {nullptr, 0};
+    events_[cnt].data.ptr = in.ptr;
+    if (cqe.res > 0 && hasBuf)
+    {
+        events_[cnt].events = EPOLLIN;
+        eventData_[cnt] = {bufBase_ + static_cast<size_t>(bid) * RECV_BUFFER_SIZE, static_cast<uint32_t>(cqe.res)};
+        if (!more)
+            armOp_(fd);
+    }
+    else if (cqe.res == -ENOBUFS)
+    {
+        /* 缓冲区用完，等loop处理完本轮归还之后再继续接收 */
+        rearm_.push_back(fd);
+        return false;
+    }
+    else
+    {
+        events_[cnt].events = cqe.res == 0 ? EPOLLRDHUP : EPOLLERR;
+    }
+    return true;
+}
+
+int UringPoller::reap_()
+{
+    int cnt = 0;
+    bool acceptReported = false;
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    while (head != tail && cnt < static_cast<int>(events_.size()))
+    {
+        const io_uring_cqe &cqe = cqes_[head & *cqMask_];
+        ++head;
+        if (cqe.user_data == REMOVE_TAG)
+            continue;
+
+        int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+        uint32_t gen = static_cast<uint32_t>(cqe.user_data >> 32) & GEN_MASK;
+        int op = static_cast<int>(cqe.user_data >> 62);
+        if (fd < 0 || static_cast<size_t>(fd) >= interests_.size())
+            continue;
+        Interest &in = interests_[fd];
+        if (op == OP_ACCEPT)
+        {
+            // 一轮中多个新连接只报告一次，loop用takeAccepted全部取走
+            if (reapAccept_(cqe, fd, gen) && !acceptReported)
+            {
+                acceptReported = true;
+                events_[cnt].data.ptr = in.ptr;
+                events_[cnt].events = EPOLLIN;
+                eventData_[cnt] = {nullptr, 0};
+                ++cnt;
+            }
+            continue;
+        }
+        if (op == OP_RECV)
+        {
+            if (reapRecv_(cqe, fd, gen, cnt))
+                ++cnt;
+            continue;
+        }
+        // 已经被modFd/delFd替换掉的请求
+        if (!in.active || (in.gen & GEN_MASK) != gen || cqe.res == -ECANCELED)
+            continue;
+
+        // multishot仍在生效时内核会带上IORING_CQE_F_MORE
+        in.armed = isMultishot_(in.events) && (cqe.flags & IORING_CQE_F_MORE);
+        events_[cnt].data.ptr = in.ptr;
+        events_[cnt].events = cqe.res < 0 ? EPOLLERR : static_cast<uint32_t>(cqe.res);
+        eventData_[cnt] = {nullptr, 0};
+        ++cnt;
+
+        // 没有ONESHOT的fd(监听socket、eventfd)自动重新注册，下一次wait时随之提交
+        if (!(in.events & EPOLLONESHOT) && !in.armed)
+        {
+            armPoll_(fd);
+        }
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+    eventCnt_ = cnt;
+    return cnt;
+}
+
+int UringPoller::wait(int timewait)
+{
+    unsigned toSubmit;
+    bool ready;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        eventCnt_ = 0;
+        recycle_();
+        __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+        toSubmit = unsubmitted_();
+        ready = *cqHead_ != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        waiting_ = !ready;
+    }
+
+    if (ready)
+    {
+        if (toSubmit)
+            enter_(toSubmit, 0, 0, nullptr, 0);
+    }
+    else
+    {
+        /* 提交积压的请求并等待至少一个完成事件 */
+        struct __kernel_timespec ts;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        if (timewait >= 0)
+        {
+            ts.tv_sec = timewait / 1000;
+            ts.tv_nsec = (timewait % 1000) * 1000000LL;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+        }
+        enter_(toSubmit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    }
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    waiting_ = false;
+    return reap_();
+}
+
+void *UringPoller::getEventPtr(size_t i) const
+{
+    return events_[i].data.ptr;
+}
+
+uint32_t UringPoller::getEvents(size_t i) const
+{
+    return events_[i].events;
+}
+
+#endif // URING_POLLER_H
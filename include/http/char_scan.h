@@ -0,0 +1,235 @@
+#ifndef CHAR_SCAN_H
+#define CHAR_SCAN_H
+
+#include <string.h> // memchr
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHAR_SCAN_X86 1
+#endif
+
+// HTTP解析中的分隔符查找，每次比较16(SSE2)或32(AVX2)字节，不足一个步长的尾部逐字节处理，不会越过end读取。
+// 启动时按CPU选择实现(AVX2 > SSE2 > 标量)，非x86平台只有标量实现
+class CharScan
+{
+public:
+    enum ISA
+    {
+        SCALAR = 0,
+        SSE2,
+        AVX2,
+        ISA_NUM,
+    };
+
+    // [p, end)中第一个控制字符(0x00-0x1F中除HTAB以外的字节和0x7F)，没有时返回end。
+    // CR、LF都是控制字符，因此一次扫描同时找到行尾并确认行内没有非法字节
+    static const char *findControl(const char *p, const char *end) { return impl_->control(p, end); }
+    // 第一个等于a或b的字节，如表单解码中的'%'和'+'
+    static const char *findEither(const char *p, const char *end, char a, char b)
+    {
+        return impl_->either(p, end, a, b);
+    }
+    // 单个字节使用memchr，libc中已经是向量化的实现
+    static const char *findByte(const char *p, const char *end, char c)
+    {
+        const char *found = static_cast<const char *>(memchr(p, c, end - p));
+        return found ? found : end;
+    }
+
+    static int isa();
+    static const char *isaName(int isa);
+    // 强制使用某一实现(用于对比测试)，CPU不支持时返回false
+    static bool setIsa(int isa);
+    static int bestIsa();
+
+private:
+    struct Impl
+    {
+        const char *(*control)(const char *, const char *);
+        const char *(*either)(const char *, const char *, char, char);
+    };
+
+    static const char *controlScalar_(const char *p, const char *end);
+    static const char *eitherScalar_(const char *p, const char *end, char a, char b);
+#ifdef CHAR_SCAN_X86
+    static const char *controlSse2_(const char *p, const char *end);
+    static const char *eitherSse2_(const char *p, const char *end, char a, char b);
+    static const char *controlAvx2_(const char *p, const char *end);
+    static const char *eitherAvx2_(const char *p, const char *end, char a, char b);
+#endif
+
+    static const Impl IMPLS[ISA_NUM];
+    static int isa_;
+    static const Impl *impl_;
+};
+
+#ifdef CHAR_SCAN_X86
+const CharScan::Impl CharScan::IMPLS[ISA_NUM] = {
+    {controlScalar_, eitherScalar_},
+    {controlSse2_, eitherSse2_},
+    {controlAvx2_, eitherAvx2_},
+};
+#else
+const CharScan::Impl CharScan::IMPLS[ISA_NUM] = {
+    {controlScalar_, eitherScalar_},
+    {controlScalar_, eitherScalar_},
+    {controlScalar_, eitherScalar_},
+};
+#endif
+
+int CharScan::isa_ = CharScan::bestIsa();
+const CharScan::Impl *CharScan::impl_ = &CharScan::IMPLS[CharScan::isa_];
+
+int CharScan::bestIsa()
+{
+#ifdef CHAR_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return AVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return SSE2;
+    }
+#endif
+    return SCALAR;
+}
+
+int CharScan::isa()
+{
+    return isa_;
+}
+
+const char *CharScan::isaName(int isa)
+{
+    static const char *NAMES[ISA_NUM] = {"scalar", "sse2", "avx2"};
+    return isa >= 0 && isa < ISA_NUM ? NAMES[isa] : "unknown";
+}
+
+bool CharScan::setIsa(int isa)
+{
+    if (isa < 0 || isa > bestIsa())
+    {
+        return false;
+    }
+    isa_ = isa;
+    impl_ = &IMPLS[isa];
+    return true;
+}
+
+const char *CharScan::controlScalar_(const char *p, const char *end)
+{
+    for (; p < end; ++p)
+    {
+        unsigned char ch = static_cast<unsigned char>(*p);
+        if ((ch < 0x20 && ch != '\t') || ch == 0x7f)
+        {
+            return p;
+        }
+    }
+    return end;
+}
+
+const char *CharScan::eitherScalar_(const char *p, const char *end, char a, char b)
+{
+    for (; p < end; ++p)
+    {
+        if (*p == a || *p == b)
+        {
+            return p;
+        }
+    }
+    return end;
+}
+
+#ifdef CHAR_SCAN_X86
+// 有符号比较: 0x80以上的字节为负数，不属于0x00-0x1F
+__attribute__((always_inline)) inline unsigned controlMask16(const char *p)
+{
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i ctl = _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(0x20), v), _mm_cmpgt_epi8(v, _mm_set1_epi8(-1)));
+    ctl = _mm_andnot_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')), ctl);
+    ctl = _mm_or_si128(ctl, _mm_cmpeq_epi8(v, _mm_set1_epi8(0x7f)));
+    return static_cast<unsigned>(_mm_movemask_epi8(ctl));
+}
+
+__attribute__((always_inline)) inline unsigned eitherMask16(const char *p, char a, char b)
+{
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(a)), _mm_cmpeq_epi8(v, _mm_set1_epi8(b)));
+    return static_cast<unsigned>(_mm_movemask_epi8(hit));
+}
+
+// 对[p, end)按STRIDE步长调用mask(q)，返回第一个置位对应的位置。
+// 区间不短于一个步长时，最后不足一步的部分改为读取[end - STRIDE, end)并去掉已经检查过的低位，避免退化为逐字节比较
+template <int STRIDE, typename MaskFn>
+__attribute__((always_inline)) inline const char *scanStrides(const char *p, const char *end, MaskFn mask)
+{
+    if (end - p < STRIDE)
+    {
+        return nullptr;
+    }
+    for (; end - p >= STRIDE; p += STRIDE)
+    {
+        unsigned m = mask(p);
+        if (m)
+        {
+            return p + __builtin_ctz(m);
+        }
+    }
+    if (p < end)
+    {
+        const char *q = end - STRIDE;
+        unsigned m = mask(q) >> (p - q);
+        if (m)
+        {
+            return p + __builtin_ctz(m);
+        }
+    }
+    return end;
+}
+
+const char *CharScan::controlSse2_(const char *p, const char *end)
+{
+    const char *found = scanStrides<16>(p, end, controlMask16);
+    return found ? found : controlScalar_(p, end);
+}
+
+const char *CharScan::eitherSse2_(const char *p, const char *end, char a, char b)
+{
+    const char *found = scanStrides<16>(p, end, [a, b](const char *q) { return eitherMask16(q, a, b); });
+    return found ? found : eitherScalar_(p, end, a, b);
+}
+
+__attribute__((target("avx2"), always_inline)) inline unsigned controlMask32(const char *p)
+{
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i ctl = _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), v), _mm256_cmpgt_epi8(v, _mm256_set1_epi8(-1)));
+    ctl = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')), ctl);
+    ctl = _mm256_or_si256(ctl, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7f)));
+    return static_cast<unsigned>(_mm256_movemask_epi8(ctl));
+}
+
+__attribute__((target("avx2"), always_inline)) inline unsigned eitherMask32(const char *p, char a, char b)
+{
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(a)), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(b)));
+    return static_cast<unsigned>(_mm256_movemask_epi8(hit));
+}
+
+// 短于32字节的区间交给SSE2
+__attribute__((target("avx2"))) const char *CharScan::controlAvx2_(const char *p, const char *end)
+{
+    const char *found = scanStrides<32>(p, end, [](const char *q) __attribute__((target("avx2"))) { return controlMask32(q); });
+    return found ? found : controlSse2_(p, end);
+}
+
+__attribute__((target("avx2"))) const char *CharScan::eitherAvx2_(const char *p, const char *end, char a, char b)
+{
+    const char *found = scanStrides<32>(p, end, [a, b](const char *q) __attribute__((target("avx2"))) { return eitherMask32(q, a, b); });
+    return found ? found : eitherSse2_(p, end, a, b);
+}
+#endif
+
+#endif // CHAR_SCAN_H
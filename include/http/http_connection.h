@@ -7,7 +7,9 @@
 #include <iostream>
 #include <sys/types.h>
 #include <assert.h>
+#include <deque>
 
+#include "../log/log_policy.h"
 #include "http_response.h"
 #include "http_request.h"
 
@@ -26,14 +28,28 @@ public:
 
     void initHttpConn(int socketFd, const sockaddr_in &addr);
 
-    // 每个连接中定义的对缓冲区的读写接口
+    // 每个连接中定义的对缓冲区的读写接口，按isET选择触发模式
     ssize_t readBuffer(int *saveErrno);
     ssize_t writeBuffer(int *saveErrno);
+    // 触发模式在编译期确定的版本，ET为true时读写到EAGAIN为止
+    template <bool ET, typename Log = SpdLog>
+    ssize_t readBuffer(int *saveErrno);
+    template <bool ET>
+    ssize_t writeBuffer(int *saveErrno);
 
     // 关闭HTTP连接的接口
     void closeHttpConn();
     // 定义处理该HTTP连接的接口，主要分为request的解析和response的生成
     bool handleHttpConn();
+    // 解析读缓冲区中的一个请求，缓冲区为空或请求还不完整时返回false，下次读入后从停下的位置继续
+    template <typename Log = SpdLog>
+    bool parseHttpConn();
+    // 根据解析结果生成响应，并继续为读缓冲区中已经完整到达的后续请求(流水线)依次生成响应，
+    // 所有响应的头部和文件按顺序放入同一组iovec，由一次writev发出。
+    // canBlock为false时(loop线程)遇到阻塞型请求就停下，该请求留到这一批发送完后处理。返回生成的响应数。
+    // 两者每个请求都会调用，其中的info日志按Log策略输出
+    template <typename Log = SpdLog>
+    int makeHttpResponse(bool canBlock = true);
 
     // 其他方法
     const char *getIP() const;
@@ -41,33 +57,79 @@ public:
     int getFd() const;
     sockaddr_in getAddr() const;
 
-    inline int writeBytes()
+    inline size_t writeBytes() const
+    {
+        return _writeLeft;
+    }
+
+    inline size_t readBytes() const
+    {
+        return _readBuffer.readableBytes();
+    }
+
+    // 追加由poller接收好的数据(io_uring multishot recv)，这时不再调用readBuffer
+    inline void appendReadBuffer(const char *data, size_t len)
+    {
+        _readBuffer.append(data, len);
+    }
+
+    // ET模式下的上一次读取是否因为读满MAX_READ_BATCH字节而停下，socket中可能还有数据且不会再次通知
+    inline bool readMore() const
     {
-        return _iov[1].iov_len + _iov[0].iov_len;
+        return _readMore;
     }
 
+    // 最后生成的响应是否保持连接
     inline bool isKeepAlive() const
     {
-        return _request.isKeepAlive();
+        return _keepAlive;
     }
-    
-    
+
+    // 当前解析的请求，处理函数可以通过它设置BodyHandler
+    inline HttpRequest &request()
+    {
+        return _request;
+    }
+
+    // 当前请求是否会阻塞(需要交给线程池处理)
+    inline bool isBlocking() const
+    {
+        return _request.isBlocking();
+    }
+
+    // 这一批响应的文件是否都已经在页缓存中
+    bool isFileResident() const;
+    void prefetchFile();
+
+    static const int MAX_PIPELINE = 16; // 一批最多合并的响应数
+    // 一次读取最多读入的字节数，ET模式下读满后先解析(流式请求体由此及时交出)再继续读
+    static const size_t MAX_READ_BATCH = 256 * 1024;
+
 private:
+    // 发送了len字节后推进iovec
+    void advanceIov_(size_t len);
+    void unmapFiles_();
+
     int _fd; // HTTP连接对应的描述符
     struct sockaddr_in _addr; //连接的地址
     bool _isClosed; // 标记是否关闭连接
-    
+    bool _parseOk;  // 最近一次请求是否解析成功
+    bool _pending;  // 已经解析、留到下一批生成响应的请求
+    bool _keepAlive;
+    bool _readMore;
 
     int _iovCnt;
-    struct iovec _iov[2];
+    int _iovPos;       // 第一个还没有发完的iovec
+    size_t _writeLeft; // 还没有发送的字节数
+    struct iovec _iov[2 * MAX_PIPELINE]; // 各响应的头部(指向写缓冲区)和文件
 
     Buffer _readBuffer;  // 读缓冲区
-    Buffer _writeBuffer; // 写缓冲区
+    Buffer _writeBuffer; // 写缓冲区，存放这一批所有响应的头部
 
     HttpRequest _request;
-    HttpResponse _response;
-
-    
+    // 这一批响应各自的文件映射，发送完成前保持；deque追加时不移动已有元素，只增不减
+    std::deque<HttpResponse> _responses;
+    int _responseCnt;
 };
 
 
@@ -81,6 +143,13 @@ HttpConnection::HttpConnection()
     _fd = -1;
     _addr = {0};
     _isClosed = true;
+    _parseOk = false;
+    _pending = false;
+    _keepAlive = false;
+    _readMore = false;
+    _iovCnt = _iovPos = 0;
+    _writeLeft = 0;
+    _responseCnt = 0;
 }
 
 HttpConnection::~HttpConnection()
@@ -94,14 +163,21 @@ void HttpConnection::initHttpConn(int fd, const sockaddr_in &addr)
     userCount++;
     _addr = addr;
     _fd = fd;
+    _iovCnt = _iovPos = 0;
+    _writeLeft = 0;
+    _pending = false;
+    _keepAlive = false;
+    _readMore = false;
     _writeBuffer.initPtr();
     _readBuffer.initPtr();
+    _request.init();
+    _request.setBodyHandler(nullptr);
     _isClosed = false;
 }
 
 void HttpConnection::closeHttpConn()
 {
-    _response.unmapFile_();
+    unmapFiles_();
     if (_isClosed == false)
     {
         _isClosed = true;
@@ -110,92 +186,198 @@ void HttpConnection::closeHttpConn()
     }
 }
 
+ssize_t HttpConnection::readBuffer(int *saveErrno)
+{
+    return isET ? readBuffer<true>(saveErrno) : readBuffer<false>(saveErrno);
+}
+
+ssize_t HttpConnection::writeBuffer(int *saveErrno)
+{
+    return isET ? writeBuffer<true>(saveErrno) : writeBuffer<false>(saveErrno);
+}
+
+template <bool ET, typename Log>
 ssize_t HttpConnection::readBuffer(int *saveErrno)
 {
     ssize_t len = -1;
+    size_t budget = MAX_READ_BATCH;
+    _readMore = false;
     do
     {
-        len = _readBuffer.readFd(_fd, saveErrno);
-        spdlog::info("fd:{}===>Read bytes: {}", _fd, len);
+        len = _readBuffer.readFd(_fd, saveErrno, budget);
+        Log::info("fd:{}===>Read bytes: {}", _fd, len);
         if (len <= 0)
         {
             break;
         }
-    } while (isET);
+        budget -= len;
+        if (budget == 0)
+        {
+            _readMore = ET;
+            break;
+        }
+    } while (ET);
     return len;
 }
 
+template <bool ET>
 ssize_t HttpConnection::writeBuffer(int *saveErrno)
 {
     ssize_t len = -1;
     do
     {
-        len = writev(_fd, _iov, _iovCnt);
+        len = writev(_fd, _iov + _iovPos, _iovCnt - _iovPos);
         if (len <= 0)
         {
             *saveErrno = errno;
             break;
         }
-        if (_iov[0].iov_len + _iov[1].iov_len == 0)
+        advanceIov_(len);
+        if (_writeLeft == 0)
         {
+            _writeBuffer.initPtr();
             break;
         } /* 传输结束 */
-        else if (static_cast<size_t>(len) > _iov[0].iov_len)
-        {
-            _iov[1].iov_base = (uint8_t *)_iov[1].iov_base + (len - _iov[0].iov_len);
-            _iov[1].iov_len -= (len - _iov[0].iov_len);
-            if (_iov[0].iov_len)
-            {
-                _writeBuffer.initPtr();
-                _iov[0].iov_len = 0;
-            }
-        }
-        else
-        {
-            _iov[0].iov_base = (uint8_t *)_iov[0].iov_base + len;
-            _iov[0].iov_len -= len;
-            _writeBuffer.updateReadPtr(len);
-        }
-    } while (isET || writeBytes() > 10240);
+    } while (ET || writeBytes() > 10240);
     return len;
 }
 
 bool HttpConnection::handleHttpConn()
 {
-    _request.init();
+    if (!parseHttpConn())
+    {
+        return false;
+    }
+    makeHttpResponse();
+    return true;
+}
+
+template <typename Log>
+bool HttpConnection::parseHttpConn()
+{
+    if (_pending)
+    {
+        _pending = false;
+        return true;
+    }
     if (_readBuffer.readableBytes() <= 0)
     {
 
-        spdlog::info("fd:{}===>ReadBuffer is empty!", _fd);
+        Log::info("fd:{}===>ReadBuffer is empty!", _fd);
         return false;
     }
-    else if (_request.parse(_readBuffer))
+    HttpRequest::PARSE_RESULT ret = _request.parse(_readBuffer);
+    if (ret == HttpRequest::PARSE_INCOMPLETE)
     {
-        _response.init(srcDir, _request.path(), _request.isKeepAlive(), 200);
+        return false; /* 等待后续数据 */
     }
-    else
+    _parseOk = (ret == HttpRequest::PARSE_COMPLETE);
+    return true;
+}
+
+template <typename Log>
+int HttpConnection::makeHttpResponse(bool canBlock)
+{
+    unmapFiles_();
+    size_t headerEnd[MAX_PIPELINE]; /* 各响应头部在写缓冲区中的结束位置，全部生成后缓冲区地址才确定 */
+    for (;;)
     {
+        if (_responseCnt == static_cast<int>(_responses.size()))
+        {
+            _responses.emplace_back();
+        }
+        HttpResponse &response = _responses[_responseCnt];
+        if (_parseOk)
+        {
+            response.init(srcDir, _request.path(), _request.isKeepAlive(), 200);
+        }
+        else
+        {
+
+            Log::info("fd:{}===>400 error", _fd); /* 客户端的错误，不是服务器的 */
+            response.init(srcDir, _request.path(), false, 400);
+        }
+        response.makeResponse(_writeBuffer);
+        headerEnd[_responseCnt++] = _writeBuffer.readableBytes();
+        _keepAlive = _parseOk && _request.isKeepAlive();
+
+        /* 非keep-alive的响应之后的请求不再处理 */
+        if (!_keepAlive || _responseCnt == MAX_PIPELINE || _readBuffer.readableBytes() == 0 || !parseHttpConn<Log>())
+        {
+            break;
+        }
+        if (!canBlock && _request.isBlocking())
+        {
+            _pending = true;
+            break;
+        }
+    }
 
-         spdlog::error("fd:{}===>400 error", _fd);
-        _response.init(srcDir, _request.path(), false, 400);
+    char *headers = const_cast<char *>(_writeBuffer.curReadPtr());
+    size_t headerBegin = 0;
+    _iovCnt = _iovPos = 0;
+    _writeLeft = 0;
+    for (int i = 0; i < _responseCnt; ++i)
+    {
+        _iov[_iovCnt].iov_base = headers + headerBegin;
+        _iov[_iovCnt++].iov_len = headerEnd[i] - headerBegin;
+        headerBegin = headerEnd[i];
+        /* 文件 */
+        HttpResponse &response = _responses[i];
+        if (response.fileLen() > 0 && response.file())
+        {
+            _iov[_iovCnt].iov_base = response.file();
+            _iov[_iovCnt++].iov_len = response.fileLen();
+            _writeLeft += response.fileLen();
+        }
     }
+    _writeLeft += headerBegin;
+    return _responseCnt;
+}
 
-    _response.makeResponse(_writeBuffer);
-    /* 响应头 */
-    _iov[0].iov_base = const_cast<char *>(_writeBuffer.curReadPtr());
-    _iov[0].iov_len = _writeBuffer.readableBytes();
-    _iovCnt = 1;
+void HttpConnection::advanceIov_(size_t len)
+{
+    _writeLeft -= len;
+    while (_iovPos < _iovCnt && len >= _iov[_iovPos].iov_len)
+    {
+        len -= _iov[_iovPos++].iov_len;
+    }
+    if (len > 0)
+    {
+        _iov[_iovPos].iov_base = (uint8_t *)_iov[_iovPos].iov_base + len;
+        _iov[_iovPos].iov_len -= len;
+    }
+}
 
-    /* 文件 */
-    if (_response.fileLen() > 0 && _response.file())
+bool HttpConnection::isFileResident() const
+{
+    for (int i = 0; i < _responseCnt; ++i)
     {
-        _iov[1].iov_base = _response.file();
-        _iov[1].iov_len = _response.fileLen();
-        _iovCnt = 2;
+        if (!_responses[i].isFileResident())
+        {
+            return false;
+        }
     }
     return true;
 }
 
+void HttpConnection::prefetchFile()
+{
+    for (int i = 0; i < _responseCnt; ++i)
+    {
+        _responses[i].prefetchFile();
+    }
+}
+
+void HttpConnection::unmapFiles_()
+{
+    for (int i = 0; i < _responseCnt; ++i)
+    {
+        _responses[i].unmapFile_();
+    }
+    _responseCnt = 0;
+}
+
 int HttpConnection::getFd() const
 {
     return _fd;
@@ -4,10 +4,26 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
-#include <regex>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <functional>
+#include <algorithm>
+#include <stdint.h>  // uintptr_t
+#include <string.h>  // memchr
+#include <strings.h> // strncasecmp
+#include <ctype.h>   // isxdigit
 
 #include "../buffer/buffer.h"
-
+#include "char_scan.h"
+
+// HTTP/1.1请求解析器(RFC 9112)，按行推进的状态机，直接在Buffer的内存上扫描，不使用正则也不复制行；
+// 行尾、冒号和表单中的转义由CharScan按向量步长查找。
+// 请求分多次到达时保留状态和扫描位置，下次从停下的地方继续，每次只扫描新到达的字节。
+// method、target、头部和请求体切片都是指向读缓冲区的string_view，在下一次向该缓冲区读入数据之前有效
+// (解析未完成时由parse在继续前移到缓冲区的新地址)；需要改写的path和表单字段是自有的字符串。
+// 请求体按Content-Length或分块编码(chunked)读取，解码后的数据不复制，
+// 默认作为切片留在读缓冲区中(不超过maxBodyBytes)，设置了BodyHandler时可以逐段交给sink
 class HttpRequest
 {
 public:
@@ -15,7 +31,11 @@ public:
     {
         REQUEST_LINE,
         HEADERS,
-        BODY,
+        BODY,           // Content-Length指定长度的请求体
+        CHUNK_SIZE,     // 分块编码: 块长度行
+        CHUNK_DATA,
+        CHUNK_DATA_END, // 块数据之后的CRLF
+        TRAILERS,       // 最后一块之后的trailer字段，校验后丢弃
         FINISH,
     };
 
@@ -31,37 +51,118 @@ public:
         CLOSED_CONNECTION,
     };
 
-    HttpRequest() { init(); };
+    // parse的结果
+    enum PARSE_RESULT
+    {
+        PARSE_INCOMPLETE = 0, // 请求还没有完整到达，缓冲区保持不变，已解析的部分保留到下次调用
+        PARSE_COMPLETE,       // 解析出一个完整的请求，读指针移到请求之后
+        PARSE_ERROR,          // 语法错误或超出限制，缓冲区中的数据全部丢弃
+    };
+
+    struct Header
+    {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    // 接收请求体的一段数据(指向读缓冲区，调用返回后即被丢弃)，空的view表示请求体结束；返回false时请求按错误处理
+    typedef std::function<bool(std::string_view)> BodySink;
+    // 头部解析完成、请求体开始之前调用，返回请求体的sink；返回空时请求体留在读缓冲区中，通过bodySlices()访问
+    typedef std::function<BodySink(const HttpRequest &)> BodyHandler;
+
+    static const size_t MAX_HEADER_BYTES = 16384; // 请求行和头部的总长度上限，trailer另计
+    static const size_t MAX_HEADERS = 64;
+    static const size_t MAX_CHUNK_LINE = 1024;    // 块长度行(含扩展)的长度上限
+    static size_t maxBodyBytes; // 每个请求留在内存中的请求体上限(含分块编码的格式字节)，交给sink的部分不计
+
+    HttpRequest() { headers_.reserve(MAX_HEADERS); init(); };
     ~HttpRequest() = default;
 
     void init();
-    bool parse(Buffer &buff); // 解析HTTP请求
+    // 解析HTTP请求，上一个请求完成(或出错)后的调用开始解析下一个请求
+    PARSE_RESULT parse(Buffer &buff);
 
     // 获取HTTP信息
     std::string path() const;
     std::string &path();
-    std::string method() const;
-    std::string version() const;
+    std::string_view method() const;
+    std::string_view version() const; // 如"1.1"
+    std::string_view query() const;   // target中'?'之后的部分
+    // 解码后的请求体，按到达的顺序；Content-Length的请求体是一段，分块编码每块一段。交给sink时为空
+    const std::vector<std::string_view> &bodySlices() const;
+    size_t bodyLength() const; // 解码后请求体的总长度
+    // 按名称查找头部(不区分大小写)，不存在时返回空
+    std::string_view header(std::string_view name) const;
+    const std::vector<Header> &headers() const;
     std::string getPost(const std::string &key) const;
     std::string getPost(const char *key) const;
 
+    // 之后该连接上的请求都使用handler，由连接的处理函数设置，init()不清除
+    void setBodyHandler(BodyHandler handler);
+
     bool isKeepAlive() const;
+    // 请求是否需要访问阻塞资源(用户数据等)，run-to-completion模式下交给线程池
+    bool isBlocking() const;
 
 private:
-    bool parseRequestLine_(const std::string &line);   // 解析请求行
-    void parseRequestHeader_(const std::string &line); // 解析请求头
-    void parseDataBody_(const std::string &line);      // 解析数据体
+    bool parseRequestLine_(std::string_view line);   // 解析请求行
+    bool parseRequestHeader_(std::string_view line); // 解析请求头
+    bool parseTarget_(std::string_view target);
+    bool finishHeaders_(); // 头部结束后检查Content-Length、Transfer-Encoding，选择请求体的sink
+    bool parseChunkSize_(std::string_view line);
+    // 当前行(包括还不完整的行)是否超出所在部分的长度上限
+    bool lineTooLong_(size_t requestBytes, size_t lineBytes) const;
+    // 交出一段请求体
+    bool deliver_(const char *data, size_t len);
 
     void parsePath_();
     void parsePost_();
 
+    PARSE_RESULT fail_(Buffer &buff);
+    // 请求还不完整，记录继续解析的位置
+    PARSE_RESULT suspend_(Buffer &buff, const char *p, const char *scan);
+    // 请求的起始地址变为begin时移动已解析出的string_view
+    void rebase_(const char *begin);
+
     static int convertHex(char ch);
+    // 把application/x-www-form-urlencoded编码的in解码后追加到out；
+    // escape保存上一段末尾被截断的转义，in可以是同一字段分成的任意多段
+    static void urlDecode_(std::string_view in, std::string *out, std::string *escape);
+    // field-line = field-name ":" OWS field-value OWS
+    static bool splitField_(std::string_view line, Header *field);
+    static bool equalsIgnoreCase_(std::string_view a, std::string_view b);
+    // 逗号分隔的头部值中是否包含token(不区分大小写)
+    static bool hasToken_(std::string_view value, std::string_view token);
+
+    // 字符类别，CHAR_CLASS中按位记录
+    enum CHAR_CLASS_BIT
+    {
+        TCHAR = 1,  // token中允许的字符
+        PCHAR = 2,  // target中允许的字符(不含'%'，转义单独检查)
+    };
+    static const std::array<uint8_t, 256> CHAR_CLASS;
+    static bool is_(char ch, int cls) { return CHAR_CLASS[static_cast<uint8_t>(ch)] & cls; }
 
     PARSE_STATE state_;
-    std::string method_, path_, version_, body_;
-    std::unordered_map<std::string, std::string> header_;
+    size_t parsed_;  // 请求起始处到已解析完的最后一行之后的字节数
+    size_t scanned_; // 当前行中已确认不含控制字符的部分结束的位置(相对请求起始处)
+    uintptr_t base_; // 上次返回时请求的起始地址
+    bool blocking_;
+    bool keepAlive_;
+    bool chunked_;
+    size_t contentLength_;
+    size_t bodyStart_;    // 请求体在请求中的起始位置
+    size_t bodyLeft_;     // 当前请求体或块还没有到达的字节数
+    size_t bodyLength_;
+    size_t trailerBytes_;
+    std::string path_;
+    std::string_view method_, version_, query_;
+    std::vector<Header> headers_;
+    std::vector<std::string_view> bodySlices_;
+    BodyHandler bodyHandler_;
+    BodySink sink_;
     std::unordered_map<std::string, std::string> post_;
-    
+
     //处理逻辑HTML的逻辑跳转
     static const std::unordered_set<std::string> DEFAULT_HTML;
     static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG;
@@ -74,65 +175,250 @@ const std::unordered_set<std::string> HttpRequest::DEFAULT_HTML{
 const std::unordered_map<std::string, int> HttpRequest::DEFAULT_HTML_TAG {
         {"/register.html", 0}, {"/doLogin", 1},  };
 
+size_t HttpRequest::maxBodyBytes = 1 << 20;
+
+const std::array<uint8_t, 256> HttpRequest::CHAR_CLASS = []() {
+    std::array<uint8_t, 256> table{};
+    for(int ch = 0; ch < 256; ++ch) {
+        bool alnum = (ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+        if(alnum || strchr("!#$%&'*+-.^_`|~", ch)) {
+            table[ch] |= TCHAR;
+        }
+        if(alnum || strchr("-._~!$&'()*+,;=:@/?", ch)) {
+            table[ch] |= PCHAR;
+        }
+    }
+    table[0] = 0; /* strchr会匹配结尾的'\0' */
+    return table;
+}();
+
 void HttpRequest::init() {
-    method_ = path_ = version_ = body_ = "";
+    path_.clear();
+    method_ = version_ = query_ = std::string_view();
     state_ = REQUEST_LINE;
-    header_.clear();
+    parsed_ = scanned_ = 0;
+    base_ = 0;
+    blocking_ = false;
+    keepAlive_ = false;
+    chunked_ = false;
+    contentLength_ = 0;
+    bodyStart_ = bodyLeft_ = bodyLength_ = 0;
+    trailerBytes_ = 0;
+    headers_.clear();
+    bodySlices_.clear();
+    sink_ = nullptr;
     post_.clear();
 }
 
+void HttpRequest::setBodyHandler(BodyHandler handler) {
+    bodyHandler_ = std::move(handler);
+}
+
 bool HttpRequest::isKeepAlive() const {
-    if(header_.count("Connection") == 1) {
-        return header_.find("Connection")->second == "keep-alive" && version_ == "1.1";
-    }
-    return false;
+    return keepAlive_;
 }
 
-bool HttpRequest::parse(Buffer& buff) {
-    //回车换行符
-    const char CRLF[] = "\r\n";
+bool HttpRequest::isBlocking() const {
+    return blocking_;
+}
 
-    //缓冲区没有可读的数据
-    if(buff.readableBytes() <= 0) {
-        return false;
+HttpRequest::PARSE_RESULT HttpRequest::parse(Buffer& buff) {
+    if(state_ == FINISH) {
+        init();
     }
-
-    while(buff.readableBytes() && state_ != FINISH) {
-        const char* lineEnd = std::search(buff.curReadPtr(), buff.curWritePtrConst(), CRLF, CRLF + 2);
-        std::string line(buff.curReadPtr(), lineEnd);
+    const char *begin = buff.curReadPtr();
+    const char *end = buff.curWritePtrConst();
+    rebase_(begin);
+    const char *p = begin + parsed_;
+    const char *scan = begin + scanned_;
+
+    while(state_ != FINISH) {
+        if(state_ == BODY || state_ == CHUNK_DATA) {
+            size_t n = std::min(static_cast<size_t>(end - p), bodyLeft_);
+            if(!deliver_(p, n)) {
+                return fail_(buff);
+            }
+            p = scan = p + n;
+            bodyLeft_ -= n;
+            if(bodyLeft_ > 0) {
+                return suspend_(buff, p, scan);
+            }
+            state_ = state_ == BODY ? FINISH : CHUNK_DATA_END;
+            continue;
+        }
+        if(state_ == CHUNK_DATA_END) {
+            if(end - p < 2) {
+                return suspend_(buff, p, p);
+            }
+            if(p[0] != '\r' || p[1] != '\n') {
+                return fail_(buff);
+            }
+            p = scan = p + 2;
+            state_ = CHUNK_SIZE;
+            continue;
+        }
+        //行内第一个控制字符必须是CRLF中的CR: 单独的LF、单独的CR和其他控制字符都是错误
+        const char *lineEnd = CharScan::findControl(scan, end);
+        if(lineEnd == end || (*lineEnd == '\r' && lineEnd + 1 == end)) {
+            if(lineTooLong_(end - begin, end - p)) {
+                return fail_(buff);
+            }
+            /* 行尾还没有到达: 下次从未检查的字节继续，末尾单独的CR等下一个字节到达后再判断 */
+            return suspend_(buff, p, lineEnd);
+        }
+        if(lineEnd[0] != '\r' || lineEnd[1] != '\n') {
+            return fail_(buff);
+        }
+        std::string_view line(p, lineEnd - p);
+        if(lineTooLong_(lineEnd + 2 - begin, lineEnd + 2 - p)) {
+            return fail_(buff);
+        }
+        p = scan = lineEnd + 2;
         switch(state_)
         {
         case REQUEST_LINE:
-            //std::cout<<"REQUEST: "<<line<<std::endl;
+            if(line.empty()) {
+                break; /* 请求行之前的空行忽略 */
+            }
             if(!parseRequestLine_(line)) {
-                return false;
+                return fail_(buff);
             }
             parsePath_();
-            break;    
+            state_ = HEADERS;
+            break;
         case HEADERS:
-            parseRequestHeader_(line);
-            if(buff.readableBytes() <= 2) {
-                state_ = FINISH;
+            if(line.empty()) {
+                if(!finishHeaders_()) {
+                    return fail_(buff);
+                }
+                bodyStart_ = p - begin;
+                bodyLeft_ = contentLength_;
+                state_ = chunked_ ? CHUNK_SIZE : (contentLength_ > 0 ? BODY : FINISH);
+                break;
             }
+            if(!parseRequestHeader_(line)) {
+                return fail_(buff);
+            }
+            break;
+        case CHUNK_SIZE:
+            if(!parseChunkSize_(line)) {
+                return fail_(buff);
+            }
+            state_ = bodyLeft_ > 0 ? CHUNK_DATA : TRAILERS;
             break;
-        case BODY:
-            parseDataBody_(line);
+        case TRAILERS: {
+            if(line.empty()) {
+                state_ = FINISH;
+                break;
+            }
+            trailerBytes_ += line.size() + 2;
+            Header trailer;
+            if(!splitField_(line, &trailer)) {
+                return fail_(buff);
+            }
             break;
+        }
         default:
             break;
         }
-        if(lineEnd == buff.curWritePtr()) { break; }
-        buff.updateReadPtrUntilEnd(lineEnd + 2);
     }
-    //解析成功
+    if(!sink_ && static_cast<size_t>(p - begin) - bodyStart_ > maxBodyBytes) {
+        return fail_(buff);
+    }
+    if(sink_ && !sink_(std::string_view())) {
+        return fail_(buff);
+    }
+    buff.updateReadPtrUntilEnd(p);
+    parsePost_();
+    return PARSE_COMPLETE;
+}
+
+//有sink时已经交出的请求体从缓冲区中删除，只留下还不完整的块长度行或trailer；
+//没有sink时请求体留在缓冲区中，到达的部分(含分块编码的格式字节)不能超过maxBodyBytes
+HttpRequest::PARSE_RESULT HttpRequest::suspend_(Buffer& buff, const char *p, const char *scan) {
+    const char *begin = buff.curReadPtr();
+    if(state_ > HEADERS) {
+        const char *body = begin + bodyStart_;
+        if(sink_) {
+            buff.erase(body, p);
+            scan -= p - body;
+            p = body;
+        } else if(static_cast<size_t>(buff.curWritePtrConst() - body) > maxBodyBytes) {
+            return fail_(buff);
+        }
+    }
+    parsed_ = p - begin;
+    scanned_ = scan - begin;
+    return PARSE_INCOMPLETE;
+}
+
+bool HttpRequest::lineTooLong_(size_t requestBytes, size_t lineBytes) const {
+    switch(state_)
+    {
+    case CHUNK_SIZE:
+        return lineBytes > MAX_CHUNK_LINE;
+    case TRAILERS:
+        return trailerBytes_ + lineBytes > MAX_HEADER_BYTES;
+    default:
+        return requestBytes > MAX_HEADER_BYTES;
+    }
+}
+
+bool HttpRequest::deliver_(const char *data, size_t len) {
+    if(len == 0) {
+        return true;
+    }
+    bodyLength_ += len;
+    if(sink_) {
+        return sink_(std::string_view(data, len));
+    }
+    /* 同一段连续到达的数据合并为一个切片 */
+    if(!bodySlices_.empty() && bodySlices_.back().data() + bodySlices_.back().size() == data) {
+        bodySlices_.back() = std::string_view(bodySlices_.back().data(), bodySlices_.back().size() + len);
+    } else {
+        bodySlices_.emplace_back(data, len);
+    }
     return true;
 }
 
+HttpRequest::PARSE_RESULT HttpRequest::fail_(Buffer& buff) {
+    buff.updateReadPtr(buff.readableBytes());
+    state_ = FINISH;
+    keepAlive_ = false;
+    return PARSE_ERROR;
+}
+
+//读入数据时缓冲区可能扩容或把数据移到开头，已解析的部分按相对请求起始处的偏移移到新的地址
+void HttpRequest::rebase_(const char *begin) {
+    uintptr_t to = reinterpret_cast<uintptr_t>(begin);
+    if(parsed_ > 0 && to != base_) {
+        auto move = [this, to](std::string_view &view) {
+            if(view.data() != nullptr) {
+                uintptr_t offset = reinterpret_cast<uintptr_t>(view.data()) - base_;
+                view = std::string_view(reinterpret_cast<const char *>(to + offset), view.size());
+            }
+        };
+        move(method_);
+        move(version_);
+        move(query_);
+        for(Header &h : headers_) {
+            move(h.name);
+            move(h.value);
+        }
+        for(std::string_view &slice : bodySlices_) {
+            move(slice);
+        }
+    }
+    base_ = to;
+}
+
 void HttpRequest::parsePath_() {
+    //登录/注册等表单处理会访问用户数据
+    blocking_ = DEFAULT_HTML_TAG.count(path_) > 0;
     if(path_ == "/") {
-        path_ = "/login.html"; 
+        path_ = "/login.html";
     } else if(path_ == "/doLogin") {
-         path_ = path_; 
+         path_ = path_;
     }
     else {
         for(auto &item: DEFAULT_HTML) {
@@ -144,103 +430,301 @@ void HttpRequest::parsePath_() {
     }
 }
 
-bool HttpRequest::parseRequestLine_(const std::string& line) {
-    std::regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-    std::smatch subMatch;
-    if(regex_match(line, subMatch, patten)) {   
-        method_ = subMatch[1];
-        path_ = subMatch[2];
-        version_ = subMatch[3];
-        state_ = HEADERS;
+//request-line = method SP request-target SP HTTP-version，各部分之间只能有一个空格
+bool HttpRequest::parseRequestLine_(std::string_view line) {
+    size_t i = 0, n = line.size();
+    while(i < n && is_(line[i], TCHAR)) {
+        ++i;
+    }
+    if(i == 0 || i == n || line[i] != ' ') {
+        return false;
+    }
+    method_ = line.substr(0, i);
+
+    size_t targetBegin = ++i;
+    while(i < n && line[i] != ' ') {
+        ++i;
+    }
+    if(i == n || !parseTarget_(line.substr(targetBegin, i - targetBegin))) {
+        return false;
+    }
+
+    //HTTP-version = "HTTP/" DIGIT "." DIGIT，只接受1.x
+    std::string_view version = line.substr(i + 1);
+    if(version.size() != 8 || version.substr(0, 5) != "HTTP/" || version[5] != '1' || version[6] != '.'
+       || version[7] < '0' || version[7] > '9') {
+        return false;
+    }
+    version_ = version.substr(5);
+    //HTTP/1.1默认持久连接，HTTP/1.0需要显式的keep-alive，由Connection头部修正
+    keepAlive_ = version_ != "1.0";
+    return true;
+}
+
+//只接受origin-form(以'/'开头)和OPTIONS的"*"，转义必须是'%'加两个十六进制数字，路径中不允许".."段
+bool HttpRequest::parseTarget_(std::string_view target) {
+    if(target == "*") {
+        if(method_ != "OPTIONS") {
+            return false;
+        }
+        path_ = "*";
         return true;
     }
-    return false;
+    if(target.empty() || target[0] != '/') {
+        return false;
+    }
+    size_t pathEnd = target.size();
+    for(size_t i = 0; i < target.size(); ++i) {
+        char ch = target[i];
+        if(ch == '%') {
+            if(i + 2 >= target.size() || !isxdigit(static_cast<unsigned char>(target[i + 1]))
+               || !isxdigit(static_cast<unsigned char>(target[i + 2]))) {
+                return false;
+            }
+            i += 2;
+        } else if(!is_(ch, PCHAR)) {
+            return false;
+        } else if(ch == '?' && pathEnd == target.size()) {
+            pathEnd = i;
+        }
+    }
+    std::string_view path = target.substr(0, pathEnd);
+    for(size_t pos = path.find(".."); pos != std::string_view::npos; pos = path.find("..", pos + 1)) {
+        bool segBegin = path[pos - 1] == '/';
+        bool segEnd = pos + 2 == path.size() || path[pos + 2] == '/';
+        if(segBegin && segEnd) {
+            return false;
+        }
+    }
+    path_.assign(path.data(), path.size());
+    query_ = pathEnd < target.size() ? target.substr(pathEnd + 1) : std::string_view();
+    return true;
 }
 
-void HttpRequest::parseRequestHeader_(const std::string& line) {
-    std::regex patten("^([^:]*): ?(.*)$");
-    std::smatch subMatch;
-    if(regex_match(line, subMatch, patten)) {
-        header_[subMatch[1]] = subMatch[2];
+bool HttpRequest::parseRequestHeader_(std::string_view line) {
+    Header field;
+    if(headers_.size() >= MAX_HEADERS || !splitField_(line, &field)) {
+        return false;
     }
-    else {
-        state_ = BODY;
+    headers_.push_back(field);
+    return true;
+}
+
+//名称和冒号之间不能有空白，不接受obs-fold续行
+bool HttpRequest::splitField_(std::string_view line, Header *field) {
+    size_t n = line.size();
+    size_t i = CharScan::findByte(line.data(), line.data() + n, ':') - line.data();
+    if(i == 0 || i == n) {
+        return false;
+    }
+    std::string_view name = line.substr(0, i);
+    for(char ch : name) {
+        if(!is_(ch, TCHAR)) {
+            return false;
+        }
     }
+    ++i;
+    while(i < n && (line[i] == ' ' || line[i] == '\t')) {
+        ++i;
+    }
+    size_t valueEnd = n;
+    while(valueEnd > i && (line[valueEnd - 1] == ' ' || line[valueEnd - 1] == '\t')) {
+        --valueEnd;
+    }
+    /* 值中的控制字符在查找行尾时已经排除 */
+    field->name = name;
+    field->value = line.substr(i, valueEnd - i);
+    return true;
 }
 
-//解析请求数据体
-void HttpRequest::parseDataBody_(const std::string& line) {
-    body_ = line;
-    parsePost_();
-    state_ = FINISH;
+bool HttpRequest::finishHeaders_() {
+    bool hasLength = false;
+    bool hasEncoding = false;
+    for(const Header &h : headers_) {
+        if(equalsIgnoreCase_(h.name, "Connection")) {
+            if(hasToken_(h.value, "close")) {
+                keepAlive_ = false;
+            } else if(hasToken_(h.value, "keep-alive")) {
+                keepAlive_ = true;
+            }
+        } else if(equalsIgnoreCase_(h.name, "Content-Length")) {
+            //只接受十进制数字，多个Content-Length必须一致
+            if(h.value.empty() || h.value.size() > 10) {
+                return false;
+            }
+            size_t len = 0;
+            for(char ch : h.value) {
+                if(ch < '0' || ch > '9') {
+                    return false;
+                }
+                len = len * 10 + (ch - '0');
+            }
+            if(hasLength && len != contentLength_) {
+                return false;
+            }
+            hasLength = true;
+            contentLength_ = len;
+        } else if(equalsIgnoreCase_(h.name, "Transfer-Encoding")) {
+            //只支持单独的chunked，其他编码无法确定请求体的长度
+            if(hasEncoding || !equalsIgnoreCase_(h.value, "chunked")) {
+                return false;
+            }
+            hasEncoding = true;
+        }
+    }
+    //同时出现时两者对请求体长度的理解可能不同(请求走私)，HTTP/1.0不支持分块编码
+    if(hasEncoding && (hasLength || version_ == "1.0")) {
+        return false;
+    }
+    chunked_ = hasEncoding;
+    if(bodyHandler_ && (chunked_ || contentLength_ > 0)) {
+        sink_ = bodyHandler_(*this);
+    }
+    return sink_ || contentLength_ <= maxBodyBytes;
+}
+
+//chunk-size [chunk-ext] CRLF，扩展忽略
+bool HttpRequest::parseChunkSize_(std::string_view line) {
+    size_t i = 0, size = 0;
+    for(; i < line.size() && isxdigit(static_cast<unsigned char>(line[i])); ++i) {
+        if(i == 15) {
+            return false; /* 超过60位 */
+        }
+        size = size * 16 + convertHex(line[i]);
+    }
+    if(i == 0) {
+        return false;
+    }
+    while(i < line.size() && (line[i] == ' ' || line[i] == '\t')) {
+        ++i;
+    }
+    if(i < line.size() && line[i] != ';') {
+        return false;
+    }
+    if(!sink_ && bodyLength_ + size > maxBodyBytes) {
+        return false;
+    }
+    bodyLeft_ = size;
+    return true;
 }
 
 //十六进制转换
 int HttpRequest::convertHex(char ch) {
     if(ch >= 'A' && ch <= 'F') return ch -'A' + 10;
     if(ch >= 'a' && ch <= 'f') return ch -'a' + 10;
-    return ch;
+    if(ch >= '0' && ch <= '9') return ch - '0';
+    return 0;
 }
 
-void HttpRequest::parsePost_() {
-    if(method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded") {
-        if(body_.size() == 0) { return; }
-        
-
-        //解析body 获取到body里面的值
-        std::string key, value;
-        int num = 0;
-        int n = body_.size();
-        int i = 0, j = 0;
-
-        for(; i < n; i++) {
-            char ch = body_[i];
-            switch (ch) {
-            case '=':
-                key = body_.substr(j, i - j);
-                j = i + 1;
-                break;
-            case '+':
-                body_[i] = ' ';
-                break;
-            case '%':
-                num = convertHex(body_[i + 1]) * 16 + convertHex(body_[i + 2]);
-                body_[i + 2] = num % 10 + '0';
-                body_[i + 1] = num / 10 + '0';
-                i += 2;
-                break;
-            case '&':
-                value = body_.substr(j, i - j);
-                j = i + 1;
-                post_[key] = value;
-                break;
-            default:
-                break;
-            }
+void HttpRequest::urlDecode_(std::string_view in, std::string *out, std::string *escape) {
+    const char *p = in.data();
+    const char *end = p + in.size();
+    if(!escape->empty()) {
+        while(escape->size() < 3 && p < end) {
+            escape->push_back(*p++);
         }
-
-        assert(j <= i);
-        if(post_.count(key) == 0 && j < i) {
-            value = body_.substr(j, i - j);
-            post_[key] = value;
+        if(escape->size() < 3) {
+            return;
+        }
+        out->push_back(static_cast<char>(convertHex((*escape)[1]) * 16 + convertHex((*escape)[2])));
+        escape->clear();
+    }
+    while(p < end) {
+        /* 两个特殊字符之间的部分整段复制 */
+        const char *special = CharScan::findEither(p, end, '%', '+');
+        out->append(p, special - p);
+        if(special == end) {
+            break;
+        }
+        if(*special == '+') {
+            out->push_back(' ');
+            p = special + 1;
+        } else if(end - special >= 3) {
+            out->push_back(static_cast<char>(convertHex(special[1]) * 16 + convertHex(special[2])));
+            p = special + 3;
+        } else {
+            escape->assign(special, end - special); /* 转义被分段截断，等下一段 */
+            p = end;
         }
+    }
+}
+
+bool HttpRequest::equalsIgnoreCase_(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
 
-        //验证用户登录逻辑
-        if(DEFAULT_HTML_TAG.count(path_)) {
-            int tag = DEFAULT_HTML_TAG.find(path_)->second;
-            spdlog::info("HTML_TAG===>{}",tag);
-            if(tag == 0 || tag == 1) {
-                bool isLogin = (tag == 1);
-                if(isLogin && post_["username"]=="admin" && post_["password"]=="123456") {
-                    path_ = "/index.html";
-                } 
-                // else {
-                //     // path_ = "/error.html";
-                // }
+bool HttpRequest::hasToken_(std::string_view value, std::string_view token) {
+    while(!value.empty()) {
+        size_t comma = value.find(',');
+        std::string_view item = value.substr(0, comma);
+        while(!item.empty() && (item.front() == ' ' || item.front() == '\t')) item.remove_prefix(1);
+        while(!item.empty() && (item.back() == ' ' || item.back() == '\t')) item.remove_suffix(1);
+        if(equalsIgnoreCase_(item, token)) {
+            return true;
         }
+        if(comma == std::string_view::npos) {
+            break;
+        }
+        value.remove_prefix(comma + 1);
     }
+    return false;
+}
 
-    }   
+//解析application/x-www-form-urlencoded的请求体，逐个切片按'&'和'='切分后解码，字段可以跨切片
+void HttpRequest::parsePost_() {
+    if(method_ != "POST" || !equalsIgnoreCase_(header("Content-Type"), "application/x-www-form-urlencoded")) {
+        return;
+    }
+    std::string key, value, escape;
+    std::string *field = &key;
+    size_t pairBytes = 0;
+    auto finishPair = [&]() {
+        if(pairBytes > 0) {
+            post_[key] = value; /* 空的字段对("&&")跳过，字段末尾不完整的转义丢弃 */
+        }
+        key.clear();
+        value.clear();
+        escape.clear();
+        field = &key;
+        pairBytes = 0;
+    };
+    for(std::string_view slice : bodySlices_) {
+        const char *p = slice.data();
+        const char *end = p + slice.size();
+        while(p < end) {
+            /* 值中的'='是普通字符 */
+            const char *sep = CharScan::findEither(p, end, '&', field == &key ? '=' : '&');
+            pairBytes += sep - p;
+            urlDecode_(std::string_view(p, sep - p), field, &escape);
+            if(sep == end) {
+                break;
+            }
+            if(*sep == '&') {
+                finishPair();
+            } else {
+                ++pairBytes;
+                escape.clear();
+                field = &value;
+            }
+            p = sep + 1;
+        }
+    }
+    finishPair();
+
+    //验证用户登录逻辑
+    if(DEFAULT_HTML_TAG.count(path_)) {
+        int tag = DEFAULT_HTML_TAG.find(path_)->second;
+        spdlog::info("HTML_TAG===>{}",tag);
+        if(tag == 0 || tag == 1) {
+            bool isLogin = (tag == 1);
+            if(isLogin && post_["username"]=="admin" && post_["password"]=="123456") {
+                path_ = "/index.html";
+            }
+            // else {
+            //     // path_ = "/error.html";
+            // }
+        }
+    }
 }
 
 std::string HttpRequest::path() const{
@@ -250,16 +734,42 @@ std::string HttpRequest::path() const{
 std::string& HttpRequest::path(){
     return path_;
 }
-std::string HttpRequest::method() const {
+
+std::string_view HttpRequest::method() const {
     return method_;
 }
 
-std::string HttpRequest::version() const {
+std::string_view HttpRequest::version() const {
     return version_;
 }
 
+std::string_view HttpRequest::query() const {
+    return query_;
+}
+
+const std::vector<std::string_view>& HttpRequest::bodySlices() const {
+    return bodySlices_;
+}
+
+size_t HttpRequest::bodyLength() const {
+    return bodyLength_;
+}
+
+std::string_view HttpRequest::header(std::string_view name) const {
+    for(const Header &h : headers_) {
+        if(equalsIgnoreCase_(h.name, name)) {
+            return h.value;
+        }
+    }
+    return std::string_view();
+}
+
+const std::vector<HttpRequest::Header>& HttpRequest::headers() const {
+    return headers_;
+}
+
 std::string HttpRequest::getPost(const std::string& key) const {
-    
+
     if(key == "") return "";
 
     //解析出来Post数据,如果查到到则就返回,没有返回空值
@@ -270,7 +780,7 @@ std::string HttpRequest::getPost(const std::string& key) const {
 }
 
 std::string HttpRequest::getPost(const char* key) const {
-    
+
     if(key == nullptr) return "";
 
     if(post_.count(key) == 1) {
@@ -279,4 +789,4 @@ std::string HttpRequest::getPost(const char* key) const {
     return "";
 }
 
-#endif
\ No newline at end of file
+#endif
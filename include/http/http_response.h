@@ -6,8 +6,10 @@
 #include <fcntl.h>  //open
 #include <unistd.h> //close
 #include <sys/stat.h> //stat
-#include <sys/mman.h> //mmap,munmap
+#include <sys/mman.h> //mmap,munmap,mincore,madvise
 #include <assert.h>
+#include <errno.h>
+#include <algorithm>
 
 #include "../buffer/buffer.h"
 
@@ -22,6 +24,10 @@ public:
     void unmapFile_();
     char* file();
     size_t fileLen() const;
+    // 映射的文件是否全部在页缓存中，不在时发送会阻塞在缺页读盘上；无法判断时返回true
+    bool isFileResident() const;
+    // 把映射的文件读入页缓存并建立映射，可能阻塞，由I/O线程调用
+    void prefetchFile();
     void errorContent(Buffer& buffer,std::string message);
     int code() const {return code_;}
 
@@ -112,15 +118,17 @@ void HttpResponse::init(const std::string& srcDir, std::string& path, bool isKee
 }
 
 void HttpResponse::makeResponse(Buffer& buff) {
-    /* 判断请求的资源文件 */
-    if(stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode)) {
-        code_ = 404;
-    }
-    else if(!(mmFileStat_.st_mode & S_IROTH)) {
-        code_ = 403;
-    }
-    else if(code_ == -1) { 
-        code_ = 200; 
+    /* 判断请求的资源文件，请求解析失败等已经确定的错误码保持不变 */
+    if(CODE_PATH.count(code_) == 0) {
+        if(stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode)) {
+            code_ = 404;
+        }
+        else if(!(mmFileStat_.st_mode & S_IROTH)) {
+            code_ = 403;
+        }
+        else if(code_ == -1) {
+            code_ = 200;
+        }
     }
     errorHTML_();
     addStateLine_(buff);
@@ -136,6 +144,39 @@ size_t HttpResponse::fileLen() const {
     return mmFileStat_.st_size;
 }
 
+bool HttpResponse::isFileResident() const {
+    if(!mmFile_ || mmFileStat_.st_size <= 0) { return true; }
+    // 对于不属于本进程用户的文件，mincore只报告本进程已映射的页，结果没有意义
+    uid_t euid = geteuid();
+    if(euid != 0 && mmFileStat_.st_uid != euid) { return true; }
+
+    static const size_t PAGE = sysconf(_SC_PAGESIZE);
+    size_t len = mmFileStat_.st_size;
+    unsigned char vec[256];
+    for(size_t off = 0; off < len; off += sizeof(vec) * PAGE) {
+        size_t n = std::min(len - off, sizeof(vec) * PAGE);
+        if(mincore(mmFile_ + off, n, vec) < 0) { return true; }
+        for(size_t i = 0; i < (n + PAGE - 1) / PAGE; ++i) {
+            if(!(vec[i] & 1)) { return false; }
+        }
+    }
+    return true;
+}
+
+void HttpResponse::prefetchFile() {
+    if(!mmFile_ || mmFileStat_.st_size <= 0) { return; }
+#ifdef MADV_POPULATE_READ
+    // 一次系统调用读入并建立映射；映射已被释放时返回错误而不是触发SIGSEGV
+    if(madvise(mmFile_, mmFileStat_.st_size, MADV_POPULATE_READ) == 0 || errno != EINVAL) { return; }
+#endif
+    /* 内核不支持时逐页访问一个字节 */
+    static const size_t PAGE = sysconf(_SC_PAGESIZE);
+    volatile char sink = 0;
+    for(size_t off = 0; off < static_cast<size_t>(mmFileStat_.st_size); off += PAGE) {
+        sink = sink + mmFile_[off];
+    }
+}
+
 void HttpResponse::errorHTML_() {
     if(CODE_PATH.count(code_) == 1) {
         path_ = CODE_PATH.find(code_)->second;
@@ -175,8 +216,10 @@ void HttpResponse::addResponseContent_(Buffer& buff) {
 
     // 将文件映射到内存提高文件的访问速度 
     // MAP_PRIVATE 建立一个写入时拷贝的私有映射
+    // 不能通过解引用判断是否失败，那样会在这里同步读入第一页(以及预读的部分)
     int* mmRet = (int*)mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
-    if(*mmRet == -1) {
+    if(mmRet == MAP_FAILED) {
+        close(srcFd);
         errorContent(buff, "File NotFound!");
         return; 
     }
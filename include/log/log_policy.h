@@ -0,0 +1,29 @@
+#ifndef LOG_POLICY_H
+#define LOG_POLICY_H
+
+#include <utility>
+
+#include "../spdlog/spdlog.h"
+
+// 热路径(每个事件、每次读写)上日志的编译期策略，warn/error不经过策略，始终输出
+
+// 交给spdlog，是否输出由运行时的日志级别决定
+struct SpdLog
+{
+    template <typename... Args>
+    static void info(spdlog::format_string_t<Args...> fmt, Args &&...args)
+    {
+        spdlog::info(fmt, std::forward<Args>(args)...);
+    }
+};
+
+// info级别在编译期丢弃，连参数的格式化和级别判断都不会产生
+struct QuietLog
+{
+    template <typename... Args>
+    static void info(spdlog::format_string_t<Args...>, Args &&...)
+    {
+    }
+};
+
+#endif // LOG_POLICY_H
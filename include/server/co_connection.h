@@ -0,0 +1,207 @@
+#ifndef CO_CONNECTION_H
+#define CO_CONNECTION_H
+
+#include <coroutine>
+#include <utility>
+
+#include "../coroutine/task.h"
+#include "event_loop.h"
+
+// 协程模式下一个连接的句柄，按值传给LoopOptions::handler，只用于EventLoop(DynamicPolicy)
+// 处理协程只在loop线程中运行: 读写先直接尝试，EAGAIN时挂起并等待对应事件，由loop在事件到达时恢复；
+// 处理函数返回后loop关闭连接，连接被超时或对端关闭时loop销毁协程帧
+class CoConnection
+{
+public:
+    CoConnection(EventLoop *loop, ConnectionSlot *slot, uint32_t gen) : loop_(loop), slot_(slot), gen_(gen) {}
+
+    // 挂起直到fd上出现events中的事件
+    struct IoAwaiter
+    {
+        CoConnection *conn;
+        uint32_t events;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { conn->loop_->waitIo_(conn->slot_, h, events); }
+        void await_resume() const noexcept {}
+    };
+
+    // 在pool中执行fn，完成后回到loop线程继续；pool为空时直接执行
+    template <typename F>
+    class OffloadAwaiter
+    {
+    public:
+        OffloadAwaiter(CoConnection *conn, Executor *pool, F fn, int lane)
+            : conn_(conn), pool_(pool), fn_(std::move(fn)), lane_(lane) {}
+
+        bool await_ready()
+        {
+            if (!pool_)
+            {
+                fn_();
+                return true;
+            }
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            handle_ = h;
+            root_ = conn_->slot_->co;
+            conn_->slot_->busy = true; /* 期间连接被关闭时连接和帧都由onCoOffloaded_释放 */
+            pool_->execute([this]() { run_(); }, lane_);
+        }
+
+        void await_resume() const noexcept {}
+
+    private:
+        void run_()
+        {
+            fn_();
+            /* 之后不能再访问本对象 */
+            EventLoop *loop = conn_->loop_;
+            loop->queueInLoop(std::bind(&EventLoop::onCoOffloaded_, loop, conn_->slot_, conn_->gen_, handle_, root_));
+        }
+
+        CoConnection *conn_;
+        Executor *pool_;
+        F fn_;
+        int lane_;
+        std::coroutine_handle<> handle_;
+        std::coroutine_handle<> root_;
+    };
+
+    IoAwaiter readable() { return IoAwaiter{this, EPOLLIN}; }
+    IoAwaiter writable() { return IoAwaiter{this, EPOLLOUT}; }
+
+    // 读到读缓冲区，返回新读到的字节数，0表示对端关闭，-1表示出错
+    Task<ssize_t> read();
+    // 发送makeHttpResponse设置好的响应，全部发完返回true
+    Task<bool> write();
+    // 生成并发送当前请求以及缓冲区中后续请求的响应: 阻塞型请求交给线程池生成，冷文件先由I/O线程读入
+    Task<bool> respond();
+
+    template <typename F>
+    OffloadAwaiter<F> offload(Executor *pool, F fn, int lane = LANE_FAST)
+    {
+        return OffloadAwaiter<F>(this, pool, std::move(fn), lane);
+    }
+
+    HttpConnection &http() { return slot_->conn; }
+    EventLoop *loop() const { return loop_; }
+    Executor *threadpool() const { return loop_->threadpool_; }
+
+private:
+    EventLoop *loop_;
+    ConnectionSlot *slot_;
+    uint32_t gen_;
+};
+
+// 默认的HTTP处理协程，行为与回调路径相同: 读取后依次处理缓冲区中的请求，非keep-alive时结束
+inline Task<> serveHttp(CoConnection conn);
+
+inline Task<ssize_t> CoConnection::read()
+{
+    HttpConnection &http = slot_->conn;
+    for (;;)
+    {
+        // ET模式下readBuffer读到EAGAIN为止，返回值不是读到的字节数
+        size_t before = http.readBytes();
+        int readErrno = 0;
+        ssize_t ret = http.readBuffer(&readErrno);
+        ssize_t got = static_cast<ssize_t>(http.readBytes() - before);
+        if (got > 0)
+        {
+            co_return got;
+        }
+        if (ret == 0)
+        {
+            co_return 0;
+        }
+        if (readErrno != EAGAIN)
+        {
+            co_return -1;
+        }
+        co_await readable();
+    }
+}
+
+inline Task<bool> CoConnection::write()
+{
+    HttpConnection &http = slot_->conn;
+    while (http.writeBytes() > 0)
+    {
+        int writeErrno = 0;
+        ssize_t ret = http.writeBuffer(&writeErrno);
+        if (http.writeBytes() == 0)
+        {
+            break;
+        }
+        if (ret <= 0 && writeErrno != EAGAIN)
+        {
+            co_return false;
+        }
+        loop_->stats_.add(loop_->stats_.writeWaits);
+        co_await writable();
+    }
+    co_return true;
+}
+
+inline Task<bool> CoConnection::respond()
+{
+    HttpConnection &http = slot_->conn;
+    int responses = 0;
+    if (http.isBlocking())
+    {
+        co_await offload(loop_->threadpool_, [&http, &responses]() { responses = http.makeHttpResponse(); }, LANE_DISK);
+    }
+    else
+    {
+        responses = http.makeHttpResponse(false);
+    }
+    loop_->stats_.add(loop_->stats_.requests, responses);
+    if (responses > 1)
+    {
+        loop_->stats_.add(loop_->stats_.pipelined, responses - 1);
+    }
+    if (loop_->ioPool_ && !http.isFileResident())
+    {
+        loop_->stats_.add(loop_->stats_.coldFiles);
+        co_await offload(loop_->ioPool_, [&http]() { http.prefetchFile(); });
+    }
+    co_return co_await write();
+}
+
+inline Task<> serveHttp(CoConnection conn)
+{
+    // 结果先存入局部变量再判断: GCC 12对if条件中的co_await生成的代码不会恢复执行
+    for (;;)
+    {
+        ssize_t got = co_await conn.read();
+        if (got <= 0)
+        {
+            co_return;
+        }
+        while (conn.http().parseHttpConn())
+        {
+            bool sent = co_await conn.respond();
+            if (!sent || !conn.http().isKeepAlive())
+            {
+                co_return;
+            }
+        }
+    }
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::startCo_(ConnectionSlot *slot, uint32_t gen)
+{
+    if constexpr (COROUTINES)
+    {
+        Task<> task = opts_.handler(CoConnection(this, slot, gen));
+        slot->co = task.release();
+        resumeCo_(slot, gen, slot->co);
+    }
+}
+
+#endif // CO_CONNECTION_H
@@ -0,0 +1,116 @@
+#ifndef CONNECTION_SLAB_H
+#define CONNECTION_SLAB_H
+
+#include <sys/mman.h> // mmap
+#include <assert.h>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <new>
+#include <coroutine>
+
+#include "../http/http_connection.h"
+#include "../timer/timer_queue.h"
+
+// 一个连接槽，按缓存行对齐，指针直接存放在epoll_event.data.ptr中
+struct alignas(64) ConnectionSlot
+{
+    HttpConnection conn;
+    // 每次连接关闭时递增，定时器回调和线程池任务持有创建时的值，
+    // 不一致说明连接已经关闭(fd可能已被复用)，应当直接丢弃
+    std::atomic<uint32_t> generation{0};
+    int fd = -1;
+    // 当前在poller中生效的事件，0表示ONESHOT事件已经触发、尚未重新注册
+    std::atomic<uint32_t> armedEvents{0};
+    // 以下只由loop线程修改
+    uint32_t deferredEvents = 0; // 常驻ET模式下暂缓处理的事件
+    bool busy = false;           // 连接正在由工作线程或I/O线程使用，交回loop时清除
+    bool closing = false;        // busy期间连接被关闭，fd和文件映射留到交回loop时再释放
+    std::string received;        // poller接收数据时，暂缓读取期间到达的数据先放在这里
+    TimerNode timerNode;         // 超时定时器结点，只由持有连接的loop线程操作
+    TimeStamp lastActive;        // 最近一次读写事件的时间(loop的粗粒度时钟)
+    // 以下只在协程模式下使用，只由loop线程访问
+    std::coroutine_handle<> co;     // 连接的处理协程(最外层)，busy时由线程池任务的回调负责释放
+    std::coroutine_handle<> waiter; // 正在等待I/O事件的协程
+    uint32_t waitEvents = 0;        // waiter等待的事件
+};
+
+// 以fd为下标的连接槽数组，容量为maxFd，整体一次性mmap预留，每个loop一个。
+// 连接对象在fd第一次分到本loop时才构造，未使用的槽不占用物理内存；
+// 槽所在的页只由所属loop线程触碰，按first-touch落在该线程所在的NUMA节点上。
+// 各loop的数组互不重叠，不会出现一页里相邻fd的槽属于不同loop的情况，代价是每个loop各预留一份虚拟地址
+class ConnectionSlab
+{
+public:
+    explicit ConnectionSlab(int maxFd);
+    ~ConnectionSlab();
+
+    ConnectionSlab(const ConnectionSlab &) = delete;
+    ConnectionSlab &operator=(const ConnectionSlab &) = delete;
+
+    // 获取fd对应的槽，不存在时构造，只能由持有该fd的loop调用
+    ConnectionSlot *acquire(int fd);
+    // 槽是否仍是gen对应的那个连接
+    static bool isCurrent(const ConnectionSlot *slot, uint32_t gen);
+    // 作废gen对应的连接，只有一个调用者会成功，成功者负责关闭连接
+    static bool retire(ConnectionSlot *slot, uint32_t gen);
+
+    int capacity() const;
+
+private:
+    int maxFd_;
+    size_t mapSize_;
+    ConnectionSlot *slots_;
+    std::vector<uint8_t> constructed_; // 不同fd的元素互不干扰，不能用vector<bool>
+};
+
+ConnectionSlab::ConnectionSlab(int maxFd) : maxFd_(maxFd), mapSize_(sizeof(ConnectionSlot) * maxFd), constructed_(maxFd, 0)
+{
+    void *mem = mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED)
+    {
+        throw std::bad_alloc();
+    }
+    slots_ = static_cast<ConnectionSlot *>(mem);
+}
+
+ConnectionSlab::~ConnectionSlab()
+{
+    for (int i = 0; i < maxFd_; ++i)
+    {
+        if (constructed_[i])
+        {
+            slots_[i].~ConnectionSlot();
+        }
+    }
+    munmap(slots_, mapSize_);
+}
+
+ConnectionSlot *ConnectionSlab::acquire(int fd)
+{
+    assert(fd >= 0 && fd < maxFd_);
+    if (!constructed_[fd])
+    {
+        new (&slots_[fd]) ConnectionSlot();
+        slots_[fd].fd = fd;
+        constructed_[fd] = 1;
+    }
+    return &slots_[fd];
+}
+
+bool ConnectionSlab::isCurrent(const ConnectionSlot *slot, uint32_t gen)
+{
+    return slot->generation.load(std::memory_order_acquire) == gen;
+}
+
+bool ConnectionSlab::retire(ConnectionSlot *slot, uint32_t gen)
+{
+    return slot->generation.compare_exchange_strong(gen, gen + 1, std::memory_order_acq_rel);
+}
+
+int ConnectionSlab::capacity() const
+{
+    return maxFd_;
+}
+
+#endif // CONNECTION_SLAB_H
@@ -0,0 +1,1203 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <type_traits>
+#include <unistd.h> // close()
+#include <assert.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h> // eventfd()
+#include <sys/timerfd.h> // timerfd_create()
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../spdlog/spdlog.h"
+#include "../http/http_connection.h"
+#include "../topology/cpu_topology.h"
+#include "../coroutine/frame_pool.h"
+#include "../coroutine/task.h"
+#include "connection_slab.h"
+#include "listener.h"
+#include "loop_stats.h"
+#include "loop_policy.h"
+
+class CoConnection;
+// 协程模式下每个连接的处理函数，见co_connection.h
+typedef Task<> (*ConnHandler)(CoConnection conn);
+
+// 事件循环的可调参数
+struct LoopOptions
+{
+    // run-to-completion: 在loop线程内直接完成读取、解析、响应和发送，
+    // 只把阻塞型请求(HttpConnection::isBlocking)交给线程池，省去每个事件的线程切换
+    bool runToCompletion = false;
+    // false时连接注册为常驻的边沿触发(EPOLLIN|EPOLLOUT|EPOLLET，不带EPOLLONESHOT)，
+    // 注册后不再需要epoll_ctl；连接的归属由loop线程保证，因此只在runToCompletion下生效
+    bool oneShot = true;
+    // >0时每隔statsIntervalMS毫秒输出一次LoopStats
+    int statsIntervalMS = 0;
+    // 连接超时定时器的实现，HEAP_TIMER或TIMING_WHEEL
+    int timerType = HEAP_TIMER;
+    // >0时统计每轮循环和每类事件处理的耗时，单轮耗时超过该值(微秒)时输出耗时最长的事件
+    int stallThresholdUS = 0;
+    // >0时生成响应后检查文件是否在页缓存中，不在时先由ioThreads个I/O线程读入，
+    // 再回到正常路径发送，避免loop或工作线程阻塞在缺页读盘上
+    int ioThreads = 0;
+    // 非空时每个连接由一个handler协程处理(如serveHttp)，读写都在loop线程中完成，
+    // 和runToCompletion一样可以使用常驻ET注册；协程帧从每个loop的FramePool分配。只在DynamicPolicy下生效
+    ConnHandler handler = nullptr;
+    // 每个请求留在读缓冲区中的请求体上限(字节)，超出时按400处理；BodyHandler流式接收的部分不计入
+    size_t maxBodyBytes = 1 << 20;
+};
+
+// 一个线程一个事件循环(one loop per thread)
+// 每个EventLoop拥有独立的Poller和TimerQueue，只由所属线程驱动，超时由注册在Poller中的timerfd触发；
+// 每个loop的连接槽位于自己的ConnectionSlab中，只由本loop构造和触碰。
+// Policy(见loop_policy.h)固定Poller、TimerQueue、线程池、触发模式和热路径日志的类型，
+// 具体类型时pollerType和LoopOptions::timerType不再起作用；EventLoop是全部在运行时选择的DynamicPolicy版本
+template <typename Policy>
+class BasicEventLoop
+{
+    friend class CoConnection;
+
+public:
+    BasicEventLoop(int id, int timeoutMS, uint32_t listenEvent, uint32_t connectionEvent, Executor *threadpool,
+                   ConnectionSlab *slab, int pollerType = EPOLL_POLLER, const LoopOptions &opts = LoopOptions());
+    ~BasicEventLoop();
+
+    BasicEventLoop(const BasicEventLoop &) = delete;
+    BasicEventLoop &operator=(const BasicEventLoop &) = delete;
+
+    void loop(); // 事件循环，由所属线程调用
+    void stop(); // 可以在任意线程调用
+
+    // 设置本loop负责accept的监听socket(SO_REUSEPORT模式下每个loop一个)
+    bool setListener(Listener *listener);
+    // 监听socket开启了TCP_DEFER_ACCEPT，新连接建立后直接读取
+    void setDeferAccept(bool deferAccept);
+    // loop线程启动时绑定到cpu，之后由它构造的连接槽和缓冲区按首次访问落在该CPU的NUMA节点上
+    void setCpu(int cpu);
+    // 单acceptor模式下，accept到的连接按轮询分发给peers
+    void setPeers(const std::vector<BasicEventLoop *> &peers);
+    // 读入冷文件的I/O线程池，为空时不检查
+    void setIoPool(Executor *ioPool);
+    // 由acceptor线程投递新连接，通过eventfd唤醒本loop
+    void queueConnection(int fd, const sockaddr_in &addr);
+    // 在loop线程中执行cb，可以在任意线程调用
+    void queueInLoop(std::function<void()> cb);
+
+    int id() const;
+    // 构造时poller、eventfd和timerfd是否都已就绪，调用stop()之后也返回false
+    bool isValid() const;
+    const LoopStats &stats() const;
+    bool isInLoopThread() const;
+
+    static const int MAX_FD = 65536;
+    static const size_t MAX_OFFLOAD_BATCH = 1024; // 攒够这么多任务时不等本轮结束，提前投递
+    // CoConnection绑定在EventLoop上，只有DynamicPolicy支持协程handler
+    static constexpr bool COROUTINES = std::is_same<Policy, DynamicPolicy>::value;
+
+private:
+    typedef typename Policy::Log Log;
+    typedef typename Policy::ExecutorPolicy ExecutorPolicy;
+
+    void handleListen_();
+    void handleWakeup_();
+    void handleTimer_();
+    // 分发一个就绪事件，返回处理它的LOOP_HANDLER，fd为事件对应的描述符
+    int dispatch_(void *ptr, uint32_t events, int *fd);
+    void armTimer_(); // 最早的过期时间提前时重新设置timerfd
+    // 交给线程池的任务按通道攒在offloaded_中，本轮事件处理完后每个通道一次投递
+    // 读请求走LANE_FAST；响应没能一次发完的后续写走LANE_BULK；阻塞型请求走LANE_DISK
+    void offload_(InlineTask &&task, int lane);
+    bool flushOffloaded_(); // 有任务投递时返回true
+    void dispatchConnection_(int fd, const sockaddr_in &addr);
+
+    // 以下函数中的gen是连接建立时槽的generation，用于识别过期的回调
+    void addClientConnection(int fd, sockaddr_in addr);    // 添加一个HTTP连接
+    void closeConn_(ConnectionSlot *slot, uint32_t gen);   // 关闭一个HTTP连接
+    void destroyConn_(ConnectionSlot *slot, uint32_t gen); // 在loop线程中释放连接占用的资源，gen为作废后的值
+    void onTimeout_(TimerNode *node);
+
+    void handleWrite_(ConnectionSlot *slot, uint32_t gen);
+    void handleRead_(ConnectionSlot *slot, uint32_t gen);
+
+    void onRead_(ConnectionSlot *slot, uint32_t gen);
+    void onReadMore_(ConnectionSlot *slot, uint32_t gen); // 上次读取没有读完socket时继续读
+    void onWrite_(ConnectionSlot *slot, uint32_t gen);
+    void onProcess_(ConnectionSlot *slot, uint32_t gen);
+    void onRespond_(ConnectionSlot *slot, uint32_t gen);
+    void startPrefetch_(ConnectionSlot *slot, uint32_t gen); // 在loop线程中标记busy并交给I/O线程
+    void onPrefetch_(ConnectionSlot *slot, uint32_t gen);      // 在I/O线程中读入响应文件
+    void onPrefetchDone_(ConnectionSlot *slot, uint32_t gen);
+    void sendResponse_(ConnectionSlot *slot, uint32_t gen);
+    void onOffloadDone_(ConnectionSlot *slot, uint32_t gen);
+    // busy的连接交回loop线程，期间连接已经关闭时完成推迟的释放并返回false
+    bool takeBack_(ConnectionSlot *slot, uint32_t gen);
+    // 按Policy::trigger读写连接的缓冲区
+    ssize_t readBuffer_(HttpConnection *client, int *saveErrno);
+    // 取出poller随第i个事件接收到的数据，暂缓读取时先放在槽里，由onRead_取出
+    void receive_(void *ptr, int i);
+    ssize_t writeBuffer_(HttpConnection *client, int *saveErrno);
+
+    // 协程模式
+    void startCo_(ConnectionSlot *slot, uint32_t gen); // 定义在co_connection.h中
+    void resumeCo_(ConnectionSlot *slot, uint32_t gen, std::coroutine_handle<> h);
+    // 登记h等待events，ONESHOT模式下重新注册
+    void waitIo_(ConnectionSlot *slot, std::coroutine_handle<> h, uint32_t events);
+    // 线程池执行完CoConnection::offload的任务后回到loop线程
+    void onCoOffloaded_(ConnectionSlot *slot, uint32_t gen, std::coroutine_handle<> h, std::coroutine_handle<> root);
+
+    // 注册/修改连接关注的事件，兴趣集合未变化且仍然有效时省掉系统调用
+    void addInterest_(ConnectionSlot *slot, uint32_t events);
+    void updateInterest_(ConnectionSlot *slot, uint32_t events);
+    void reportStats_();
+
+    void sendError_(int fd, const char *info);
+    void extentTime_(ConnectionSlot *slot);
+
+    int id_;
+    int timeoutMS_; /* 毫秒MS,定时器的默认过期时间 */
+    std::atomic<bool> isClose_;
+    std::thread::id threadId_;
+    int listenFd_;
+    int wakeupFd_; // 用于跨线程唤醒的eventfd
+    int timerFd_;  // 驱动超时处理的timerfd
+    bool timerArmed_;
+    TimeStamp timerExpire_; // timerfd当前设置的到期时间
+    bool deferAccept_;
+    int cpu_; // 绑定的CPU，-1表示不绑定
+    Listener *listener_;
+
+    uint32_t listenEvent_;
+    uint32_t connectionEvent_;
+    bool persistent_; // 连接为常驻ET注册(不带EPOLLONESHOT)
+    bool acceptByPoller_; // 新连接由poller accept(io_uring multishot accept)
+    bool recvByPoller_;   // 连接的数据由poller接收(io_uring multishot recv)，loop不再调用read
+    LoopOptions opts_;
+    LoopStats stats_;
+    FramePool framePool_;
+    TimeStamp lastReport_;
+
+    std::vector<BasicEventLoop *> peers_;
+    size_t nextPeer_;
+
+    std::mutex pendingMutex_;
+    std::vector<std::pair<int, sockaddr_in>> pendingConns_; // 等待本loop接管的连接
+    std::vector<std::function<void()>> pendingFunctors_;    // 等待在本loop中执行的回调
+    std::vector<InlineTask> offloaded_[LANE_NUM];            // 本轮产生、尚未投递给线程池的任务
+
+    Executor *threadpool_;
+    Executor *ioPool_;
+    ConnectionSlab *slab_; // 本loop独有，由TaoWebserver持有
+    std::unique_ptr<typename Policy::TimerType> timer_;
+    std::unique_ptr<typename Policy::PollerType> poller_;
+};
+
+typedef BasicEventLoop<DynamicPolicy> EventLoop;
+
+template <typename Policy>
+BasicEventLoop<Policy>::BasicEventLoop(int id, int timeoutMS, uint32_t listenEvent, uint32_t connectionEvent,
+                                       Executor *threadpool, ConnectionSlab *slab, int pollerType,
+                                       const LoopOptions &opts)
+    : id_(id), timeoutMS_(timeoutMS), isClose_(false), listenFd_(-1), wakeupFd_(-1), timerFd_(-1), timerArmed_(false),
+      deferAccept_(false), cpu_(-1), listener_(nullptr),
+      listenEvent_(listenEvent), connectionEvent_(connectionEvent), persistent_(!(connectionEvent & EPOLLONESHOT)),
+      acceptByPoller_(false), recvByPoller_(false), opts_(opts), lastReport_(Clock::now()), nextPeer_(0),
+      threadpool_(threadpool), ioPool_(nullptr), slab_(slab),
+      timer_(makeTimerQueue<typename Policy::TimerType>(opts.timerType)),
+      poller_(makePoller<typename Policy::PollerType>(pollerType))
+{
+    timer_->setExpireCallBack(std::bind(&BasicEventLoop::onTimeout_, this, std::placeholders::_1));
+    wakeupFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeupFd_ < 0 || !poller_->addFd(wakeupFd_, EPOLLIN, &wakeupFd_))
+    {
+        spdlog::error("loop:{}===>Create wakeup eventfd error!", id_);
+        isClose_ = true;
+    }
+    if (timeoutMS_ > 0)
+    {
+        timerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timerFd_ < 0 || !poller_->addFd(timerFd_, EPOLLIN, &timerFd_))
+        {
+            spdlog::error("loop:{}===>Create timerfd error!", id_);
+            isClose_ = true;
+        }
+    }
+    // 接收到的数据在loop线程中放入读缓冲区，只有常驻ET + run-to-completion时读缓冲区只由loop线程访问
+    recvByPoller_ = poller_->completionIo() && persistent_ && opts_.runToCompletion && !(COROUTINES && opts_.handler);
+    spdlog::info("loop:{}===>poller backend: {}{}, timer: {}", id_, poller_->name(),
+                 recvByPoller_ ? " (recv)" : "", timer_->name());
+}
+
+template <typename Policy>
+BasicEventLoop<Policy>::~BasicEventLoop()
+{
+    if (wakeupFd_ >= 0)
+    {
+        close(wakeupFd_);
+    }
+    if (timerFd_ >= 0)
+    {
+        close(timerFd_);
+    }
+    std::lock_guard<std::mutex> lk(pendingMutex_);
+    for (auto &conn : pendingConns_)
+    {
+        close(conn.first);
+    }
+}
+
+template <typename Policy>
+int BasicEventLoop<Policy>::id() const
+{
+    return id_;
+}
+
+template <typename Policy>
+bool BasicEventLoop<Policy>::isValid() const
+{
+    return !isClose_;
+}
+
+template <typename Policy>
+const LoopStats &BasicEventLoop<Policy>::stats() const
+{
+    return stats_;
+}
+
+template <typename Policy>
+bool BasicEventLoop<Policy>::isInLoopThread() const
+{
+    return threadId_ == std::this_thread::get_id();
+}
+
+template <typename Policy>
+bool BasicEventLoop<Policy>::setListener(Listener *listener)
+{
+    acceptByPoller_ = poller_->completionIo() && poller_->addAcceptor(listener->fd(), &listenFd_);
+    if (!acceptByPoller_ && !poller_->addFd(listener->fd(), listenEvent_ | EPOLLIN, &listenFd_))
+    {
+        spdlog::error("loop:{}===>Add listenevent to epoll error!", id_);
+        return false;
+    }
+    listener_ = listener;
+    listenFd_ = listener->fd();
+    return true;
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::setDeferAccept(bool deferAccept)
+{
+    deferAccept_ = deferAccept;
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::setCpu(int cpu)
+{
+    cpu_ = cpu;
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::setPeers(const std::vector<BasicEventLoop *> &peers)
+{
+    peers_ = peers;
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::setIoPool(Executor *ioPool)
+{
+    ioPool_ = ioPool;
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::stop()
+{
+    isClose_ = true;
+    uint64_t one = 1;
+    ssize_t n = write(wakeupFd_, &one, sizeof(one));
+    (void)n;
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::loop()
+{
+    // 超时由timerfd触发，只有输出统计时才需要wait超时
+    int timeMS = opts_.statsIntervalMS > 0 ? opts_.statsIntervalMS : -1;
+    bool profile = opts_.stallThresholdUS > 0;
+    threadId_ = std::this_thread::get_id();
+    if (cpu_ >= 0 && CpuTopology::pinCurrentThread(cpu_))
+    {
+        spdlog::info("loop:{}===>pinned to cpu {}", id_, cpu_);
+    }
+    for (auto &tasks : offloaded_)
+    {
+        tasks.reserve(MAX_OFFLOAD_BATCH); /* 绑定之后再分配，落在本地节点上 */
+    }
+    FramePool::setCurrent(&framePool_);
+    while (!isClose_)
+    {
+        if (timeoutMS_ > 0)
+        {
+            armTimer_();
+        }
+        int eventCnt = poller_->wait(timeMS);
+        timer_->tick(); /* 本轮所有定时器操作共用这一次时钟读取 */
+        stats_.add(stats_.iterations);
+        stats_.add(stats_.events, eventCnt);
+
+        // 开启检测时记录每个事件的处理耗时，并找出本轮耗时最长的事件
+        TimeStamp start = timer_->now();
+        TimeStamp last = start;
+        int64_t worstNS = 0;
+        int worstFd = -1, worstHandler = HANDLER_NUM;
+        uint32_t worstEvents = 0;
+        for (int i = 0; i < eventCnt; ++i)
+        {
+            void *ptr = poller_->getEventPtr(i);
+            uint32_t events = poller_->getEvents(i);
+            if (recvByPoller_ && (events & EPOLLIN))
+            {
+                receive_(ptr, i);
+            }
+            int fd = -1;
+            int handler = dispatch_(ptr, events, &fd);
+            if (profile)
+            {
+                TimeStamp now = Clock::now();
+                int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+                stats_.add(stats_.handlerNS[handler], ns);
+                stats_.add(stats_.handlerCalls[handler]);
+                if (ns > worstNS)
+                {
+                    worstNS = ns;
+                    worstFd = fd;
+                    worstHandler = handler;
+                    worstEvents = events;
+                }
+                last = now;
+            }
+        }
+        bool flushed = flushOffloaded_();
+        if (profile)
+        {
+            // 批量投递唤醒工作线程的耗时单独计为一类，本轮的耗时从wait返回算到投递结束
+            TimeStamp end = Clock::now();
+            if (flushed)
+            {
+                int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - last).count();
+                stats_.add(stats_.handlerNS[HANDLER_FLUSH], ns);
+                stats_.add(stats_.handlerCalls[HANDLER_FLUSH]);
+                if (ns > worstNS)
+                {
+                    worstNS = ns;
+                    worstFd = -1;
+                    worstHandler = HANDLER_FLUSH;
+                    worstEvents = 0;
+                }
+            }
+            int64_t iterNS = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            stats_.updateMax(stats_.maxIterNS, iterNS);
+            if (iterNS > static_cast<int64_t>(opts_.stallThresholdUS) * 1000)
+            {
+                stats_.add(stats_.stalls);
+                spdlog::warn("loop:{}===>stall {}us, events:{}, worst fd:{} handler:{} events:{:#x} {}us",
+                             id_, iterNS / 1000, eventCnt, worstFd, LoopStats::handlerName(worstHandler),
+                             worstEvents, worstNS / 1000);
+            }
+        }
+        if (opts_.statsIntervalMS > 0)
+        {
+            reportStats_();
+        }
+    }
+}
+
+template <typename Policy>
+int BasicEventLoop<Policy>::dispatch_(void *ptr, uint32_t events, int *fd)
+{
+    // 监听socket、eventfd和timerfd以成员地址作为标记，其余都是连接槽
+    if (ptr == &listenFd_)
+    {
+        *fd = listenFd_;
+        Log::info("fd:{}===>HandleListen", listenFd_);
+        handleListen_();
+        return HANDLER_LISTEN;
+    }
+    else if (ptr == &wakeupFd_)
+    {
+        *fd = wakeupFd_;
+        handleWakeup_();
+        return HANDLER_WAKEUP;
+    }
+    else if (ptr == &timerFd_)
+    {
+        *fd = timerFd_;
+        handleTimer_();
+        return HANDLER_TIMER;
+    }
+
+    ConnectionSlot *slot = static_cast<ConnectionSlot *>(ptr);
+    *fd = slot->fd;
+    uint32_t gen = slot->generation.load(std::memory_order_acquire);
+    if (!persistent_)
+    {
+        slot->armedEvents.store(0, std::memory_order_relaxed); /* ONESHOT触发后即失效 */
+    }
+
+    if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+    {
+        Log::info("fd:{}===>EPOLLRDHUP | EPOLLHUP | EPOLLERR", *fd);
+        closeConn_(slot, gen);
+        return HANDLER_CLOSE;
+    }
+    else if (COROUTINES && opts_.handler)
+    {
+        // 协程总是先尝试读写，EAGAIN后才等待，因此没有协程在等待的事件可以直接丢弃
+        if (slot->waiter && (events & slot->waitEvents))
+        {
+            extentTime_(slot);
+            resumeCo_(slot, gen, std::exchange(slot->waiter, nullptr));
+        }
+        return (events & EPOLLIN) ? HANDLER_READ : HANDLER_WRITE;
+    }
+    else if (persistent_)
+    {
+        // 常驻ET模式: 请求还在处理或响应没有发完时暂缓读取，保证同一时刻只处理一个请求
+        if (slot->busy || slot->conn.writeBytes() > 0)
+        {
+            slot->deferredEvents |= (events & EPOLLIN);
+            if (!slot->busy && (events & EPOLLOUT))
+            {
+                handleWrite_(slot, gen);
+                return HANDLER_WRITE;
+            }
+        }
+        else if (events & EPOLLIN)
+        {
+            handleRead_(slot, gen);
+        }
+        /* 没有待发送数据时的EPOLLOUT直接忽略 */
+        return HANDLER_READ;
+    }
+    else if (events & EPOLLIN)
+    {
+        Log::info("fd:{}===>EPOLLIN", *fd);
+        handleRead_(slot, gen);
+        return HANDLER_READ;
+    }
+    else if (events & EPOLLOUT)
+    {
+        Log::info("fd:{}===>EPOLLOUT", *fd);
+        handleWrite_(slot, gen);
+        return HANDLER_WRITE;
+    }
+    Log::info("fd:{}===>Unexpected event", *fd);
+    return HANDLER_READ;
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::armTimer_()
+{
+    TimeStamp expire;
+    if (!timer_->nextExpire(&expire))
+    {
+        return;
+    }
+    // 续期只会推迟最早的过期时间，此时不重设timerfd，提前醒来后再按新的时间设置
+    if (timerArmed_ && expire >= timerExpire_)
+    {
+        return;
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(expire - timer_->now()).count();
+    if (ns <= 0)
+    {
+        ns = 1; /* 全0表示取消定时 */
+    }
+    struct itimerspec ts = {};
+    ts.it_value.tv_sec = ns / 1000000000;
+    ts.it_value.tv_nsec = ns % 1000000000;
+    if (timerfd_settime(timerFd_, 0, &ts, nullptr) < 0)
+    {
+        spdlog::error("loop:{}===>timerfd_settime error: {}", id_, strerror(errno));
+        return;
+    }
+    timerArmed_ = true;
+    timerExpire_ = expire;
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::offload_(InlineTask &&task, int lane)
+{
+    offloaded_[lane].push_back(std::move(task));
+    if (offloaded_[lane].size() >= MAX_OFFLOAD_BATCH)
+    {
+        flushOffloaded_();
+    }
+}
+
+template <typename Policy>
+bool BasicEventLoop<Policy>::flushOffloaded_()
+{
+    bool posted = false;
+    for (int lane = 0; lane < LANE_NUM; ++lane)
+    {
+        std::vector<InlineTask> &tasks = offloaded_[lane];
+        if (tasks.empty())
+        {
+            continue;
+        }
+        stats_.add(stats_.offloadBatches);
+        stats_.add(stats_.offloaded, tasks.size());
+        ExecutorPolicy::postBatch(threadpool_, tasks.data(), tasks.size(), lane);
+        tasks.clear();
+        posted = true;
+    }
+    return posted;
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::handleTimer_()
+{
+    uint64_t cnt;
+    ssize_t n = read(timerFd_, &cnt, sizeof(cnt));
+    (void)n;
+    timerArmed_ = false;
+    timer_->handleExpired();
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::reportStats_()
+{
+    TimeStamp now = timer_->now();
+    if (std::chrono::duration_cast<MS>(now - lastReport_).count() < opts_.statsIntervalMS)
+    {
+        return;
+    }
+    lastReport_ = now;
+    spdlog::info("loop:{}===>stats {}", id_, stats_.toString());
+    if (framePool_.allocations())
+    {
+        spdlog::info("loop:{}===>coroutine frames allocated:{} reused:{}", id_, framePool_.allocations(),
+                     framePool_.reused());
+    }
+    if (id_ == 0)
+    {
+        /* 线程池为所有loop共享，只由loop 0输出 */
+        spdlog::info("pool===>stats {}", threadpool_->stats().toString());
+    }
+    stats_.maxIterNS.store(0, std::memory_order_relaxed);
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::sendError_(int fd, const char *info)
+{
+    assert(fd > 0);
+    int ret = send(fd, info, strlen(info), 0);
+    if (ret < 0)
+    {
+        Log::info("fd:{}===>send error to client unsuccessful.", fd);
+    }
+    close(fd);
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::closeConn_(ConnectionSlot *slot, uint32_t gen)
+{
+    assert(slot);
+    // 定时器、loop和工作线程都可能关闭连接，只有作废generation成功的一方真正关闭
+    if (!ConnectionSlab::retire(slot, gen))
+    {
+        return;
+    }
+    // 定时器结点嵌在槽中且只能由loop线程操作，fd关闭后槽可能立即被其他loop复用，
+    // 因此工作线程只负责作废，摘除定时器和关闭fd都交给loop线程
+    if (!isInLoopThread())
+    {
+        queueInLoop(std::bind(&BasicEventLoop::destroyConn_, this, slot, gen + 1));
+        return;
+    }
+    destroyConn_(slot, gen + 1);
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::destroyConn_(ConnectionSlot *slot, uint32_t gen)
+{
+    if (!ConnectionSlab::isCurrent(slot, gen))
+    {
+        return; /* 排队期间loop又作废了一次并已经释放 */
+    }
+    Log::info("fd:{}===>Client quit.", slot->fd);
+    timer_->cancel(&slot->timerNode);
+    stats_.add(stats_.ctlCalls);
+    poller_->delFd(slot->fd);
+    slot->armedEvents.store(0, std::memory_order_relaxed);
+    if (slot->co && !slot->busy)
+    {
+        slot->co.destroy(); /* 等待链上的帧随最外层一起释放，busy时由onCoOffloaded_释放 */
+    }
+    slot->co = nullptr;
+    slot->waiter = nullptr;
+    if (slot->busy)
+    {
+        // 其他线程还在使用连接的缓冲区和文件映射，fd关闭后又可能被accept复用，都留给takeBack_释放
+        slot->closing = true;
+        return;
+    }
+    slot->conn.closeHttpConn();
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::addClientConnection(int fd, sockaddr_in addr)
+{
+    assert(fd > 0);
+    ConnectionSlot *slot = slab_->acquire(fd);
+    slot->conn.initHttpConn(fd, addr);
+    slot->deferredEvents = 0;
+    slot->received.clear();
+    slot->busy = false;
+    slot->closing = false;
+    slot->lastActive = timer_->now();
+    uint32_t gen = slot->generation.load(std::memory_order_acquire);
+    if (timeoutMS_ > 0)
+    {
+        slot->timerNode.id = fd;
+        slot->timerNode.data = slot;
+        timer_->add(&slot->timerNode, timeoutMS_);
+    }
+    if (COROUTINES && opts_.handler)
+    {
+        /* 协程先尝试读取，没有数据时才等待EPOLLIN */
+        addInterest_(slot, deferAccept_ ? 0u : static_cast<uint32_t>(EPOLLIN));
+        startCo_(slot, gen);
+    }
+    else if (deferAccept_ && !recvByPoller_)
+    {
+        // TCP_DEFER_ACCEPT下accept时请求数据已经到达，不必等待EPOLLIN，直接读取；
+        // ONESHOT注册时不带EPOLLIN，由处理完成后的updateInterest_再打开
+        addInterest_(slot, 0);
+        handleRead_(slot, gen);
+    }
+    else
+    {
+        addInterest_(slot, EPOLLIN);
+    }
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::addInterest_(ConnectionSlot *slot, uint32_t events)
+{
+    uint32_t want;
+    if (persistent_)
+    {
+        want = connectionEvent_ | EPOLLIN | EPOLLOUT;
+    }
+    else
+    {
+        /* events为0时只注册ONESHOT本身，不关注任何读写事件 */
+        want = events ? (connectionEvent_ | events) : (connectionEvent_ & ~EPOLLRDHUP);
+    }
+    slot->armedEvents.store(want, std::memory_order_relaxed);
+    stats_.add(stats_.ctlCalls);
+    if (recvByPoller_)
+    {
+        poller_->addReceiver(slot->fd, want, slot);
+        return;
+    }
+    poller_->addFd(slot->fd, want, slot);
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::updateInterest_(ConnectionSlot *slot, uint32_t events)
+{
+    // 常驻ET模式下注册的集合始终是EPOLLIN|EPOLLOUT，永远不需要修改
+    uint32_t want = persistent_ ? (connectionEvent_ | EPOLLIN | EPOLLOUT) : (connectionEvent_ | events);
+    if (slot->armedEvents.load(std::memory_order_relaxed) == want)
+    {
+        stats_.add(stats_.ctlElided);
+        return;
+    }
+    slot->armedEvents.store(want, std::memory_order_relaxed);
+    stats_.add(stats_.ctlCalls);
+    poller_->modFd(slot->fd, want, slot);
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::queueConnection(int fd, const sockaddr_in &addr)
+{
+    {
+        std::lock_guard<std::mutex> lk(pendingMutex_);
+        pendingConns_.emplace_back(fd, addr);
+    }
+    uint64_t one = 1;
+    ssize_t n = write(wakeupFd_, &one, sizeof(one));
+    (void)n;
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::queueInLoop(std::function<void()> cb)
+{
+    {
+        std::lock_guard<std::mutex> lk(pendingMutex_);
+        pendingFunctors_.push_back(std::move(cb));
+    }
+    uint64_t one = 1;
+    ssize_t n = write(wakeupFd_, &one, sizeof(one));
+    (void)n;
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::handleWakeup_()
+{
+    uint64_t cnt;
+    ssize_t n = read(wakeupFd_, &cnt, sizeof(cnt));
+    (void)n;
+
+    std::vector<std::pair<int, sockaddr_in>> conns;
+    std::vector<std::function<void()>> functors;
+    {
+        std::lock_guard<std::mutex> lk(pendingMutex_);
+        conns.swap(pendingConns_);
+        functors.swap(pendingFunctors_);
+    }
+    for (auto &conn : conns)
+    {
+        addClientConnection(conn.first, conn.second);
+    }
+    for (auto &cb : functors)
+    {
+        cb();
+    }
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::dispatchConnection_(int fd, const sockaddr_in &addr)
+{
+    // 没有peers时(SO_REUSEPORT模式或只有一个loop)由自己处理
+    if (peers_.empty())
+    {
+        addClientConnection(fd, addr);
+        return;
+    }
+    BasicEventLoop *target = peers_[nextPeer_];
+    nextPeer_ = (nextPeer_ + 1) % peers_.size();
+    if (target == this)
+    {
+        addClientConnection(fd, addr);
+    }
+    else
+    {
+        target->queueConnection(fd, addr);
+    }
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::handleListen_()
+{
+    auto onAccept = [this](int fd, const sockaddr_in &addr)
+    {
+        if (HttpConnection::userCount >= MAX_FD || fd >= slab_->capacity())
+        {
+            sendError_(fd, "Server busy!");
+            Log::info("Clients is full");
+            return false;
+        }
+        dispatchConnection_(fd, addr);
+        return true;
+    };
+    if (acceptByPoller_)
+    {
+        // poller已经accept好，取走全部新连接；multishot accept不带对端地址，需要时再查
+        int fds[64];
+        size_t n;
+        while ((n = poller_->takeAccepted(fds, 64)) > 0)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                struct sockaddr_in addr;
+                socklen_t len = sizeof(addr);
+                if (getpeername(fds[i], (struct sockaddr *)&addr, &len) < 0)
+                {
+                    memset(&addr, 0, sizeof(addr));
+                }
+                onAccept(fds[i], addr);
+            }
+        }
+        return;
+    }
+    bool more = listener_->acceptBatch(onAccept);
+
+    // 达到本次accept上限时队列中可能还有连接，ET模式下不会再次通知，需要重新注册以触发
+    if (more && (listenEvent_ & EPOLLET))
+    {
+        poller_->modFd(listenFd_, listenEvent_ | EPOLLIN, &listenFd_);
+    }
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::handleRead_(ConnectionSlot *slot, uint32_t gen)
+{
+
+    extentTime_(slot);
+    if (opts_.runToCompletion)
+    {
+        onRead_(slot, gen);
+        return;
+    }
+    offload_(std::bind(&BasicEventLoop::onRead_, this, slot, gen), LANE_FAST);
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::handleWrite_(ConnectionSlot *slot, uint32_t gen)
+{
+
+    extentTime_(slot);
+    if (opts_.runToCompletion)
+    {
+        onWrite_(slot, gen);
+        return;
+    }
+    offload_(std::bind(&BasicEventLoop::onWrite_, this, slot, gen), LANE_BULK);
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::extentTime_(ConnectionSlot *slot)
+{
+
+    // 只记录活跃时间，不调整定时器；到期时再根据活跃时间决定关闭还是续期，
+    // 持续活跃的连接每个超时周期只操作一次定时器
+    if (timeoutMS_ > 0)
+    {
+        slot->lastActive = timer_->now();
+        stats_.add(stats_.timerElided);
+    }
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::onTimeout_(TimerNode *node)
+{
+    // 连接关闭时结点已经被摘除，触发的一定是当前的连接
+    ConnectionSlot *slot = static_cast<ConnectionSlot *>(node->data);
+    TimeStamp deadline = slot->lastActive + MS(timeoutMS_);
+    if (deadline > timer_->now())
+    {
+        /* 期间有过读写，按剩余时间重新加入 */
+        auto remain = std::chrono::duration_cast<MS>(deadline - timer_->now()).count() + 1;
+        stats_.add(stats_.timerRearms);
+        timer_->add(node, static_cast<int>(remain));
+        return;
+    }
+    closeConn_(slot, slot->generation.load(std::memory_order_acquire));
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::onRead_(ConnectionSlot *slot, uint32_t gen)
+{
+    if (!ConnectionSlab::isCurrent(slot, gen))
+    {
+        return; /* 连接在任务排队期间已经关闭 */
+    }
+    HttpConnection *client = &slot->conn;
+    if (recvByPoller_)
+    {
+        /* 数据已经由poller接收，只需取出暂缓期间到达的部分 */
+        if (!slot->received.empty())
+        {
+            client->appendReadBuffer(slot->received.data(), slot->received.size());
+            slot->received.clear();
+        }
+        onProcess_(slot, gen);
+        return;
+    }
+    int ret = -1;
+    int readErrno = 0;
+    ret = readBuffer_(client, &readErrno);
+
+    if (ret <= 0 && readErrno != EAGAIN)
+    {
+        if (ret == 0)
+        {
+            Log::info("fd:{}===>peer closed.", client->getFd()); /* 每个连接结束时都会走到这里 */
+        }
+        else
+        {
+            spdlog::error("fd:{}===>do not read data!", client->getFd());
+        }
+        closeConn_(slot, gen);
+        return;
+    }
+    onProcess_(slot, gen);
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::onReadMore_(ConnectionSlot *slot, uint32_t gen)
+{
+    if (!ConnectionSlab::isCurrent(slot, gen))
+    {
+        return;
+    }
+    handleRead_(slot, gen);
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::onProcess_(ConnectionSlot *slot, uint32_t gen)
+{
+    if (!ConnectionSlab::isCurrent(slot, gen))
+    {
+        return;
+    }
+    if (!slot->conn.template parseHttpConn<Log>())
+    {
+        if (slot->conn.readMore())
+        {
+            /* 交给下一轮继续读，期间其他连接的事件可以得到处理 */
+            queueInLoop(std::bind(&BasicEventLoop::onReadMore_, this, slot, gen));
+            return;
+        }
+        updateInterest_(slot, EPOLLIN);
+        return;
+    }
+    if (opts_.runToCompletion && slot->conn.isBlocking())
+    {
+        /* 阻塞型请求不能占用loop线程，处理期间连接被关闭时推迟到交回loop后释放 */
+        slot->busy = true;
+        offload_(std::bind(&BasicEventLoop::onRespond_, this, slot, gen), LANE_DISK);
+        return;
+    }
+    onRespond_(slot, gen);
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::onRespond_(ConnectionSlot *slot, uint32_t gen)
+{
+    // run-to-completion下由onProcess_交给工作线程的请求，连接处于busy，无论结果如何都要交回loop
+    bool offloaded = opts_.runToCompletion && !isInLoopThread();
+    if (!ConnectionSlab::isCurrent(slot, gen))
+    {
+        if (offloaded)
+        {
+            queueInLoop(std::bind(&BasicEventLoop::onOffloadDone_, this, slot, gen));
+        }
+        return;
+    }
+    // 在工作线程中时流水线里的阻塞型请求可以一起处理；loop线程上只有非阻塞的请求会走到这里
+    int responses = slot->conn.template makeHttpResponse<Log>(!opts_.runToCompletion || offloaded);
+    stats_.add(stats_.requests, responses);
+    if (responses > 1)
+    {
+        stats_.add(stats_.pipelined, responses - 1);
+    }
+    if (offloaded)
+    {
+        /* 交回loop线程发送 */
+        queueInLoop(std::bind(&BasicEventLoop::onOffloadDone_, this, slot, gen));
+        return;
+    }
+    sendResponse_(slot, gen);
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::startPrefetch_(ConnectionSlot *slot, uint32_t gen)
+{
+    if (!ConnectionSlab::isCurrent(slot, gen))
+    {
+        return;
+    }
+    // 读盘期间连接被关闭时由destroyConn_推迟释放，I/O线程访问的文件映射始终有效
+    slot->busy = true;
+    ioPool_->execute(std::bind(&BasicEventLoop::onPrefetch_, this, slot, gen));
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::onPrefetch_(ConnectionSlot *slot, uint32_t gen)
+{
+    if (ConnectionSlab::isCurrent(slot, gen))
+    {
+        slot->conn.prefetchFile();
+    }
+    /* 无论连接是否还在都要交回loop，由它清除busy */
+    queueInLoop(std::bind(&BasicEventLoop::onPrefetchDone_, this, slot, gen));
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::onPrefetchDone_(ConnectionSlot *slot, uint32_t gen)
+{
+    if (!takeBack_(slot, gen))
+    {
+        return;
+    }
+    if (!opts_.runToCompletion)
+    {
+        /* 发送不再阻塞，交回线程池的快速通道，I/O线程只负责读盘 */
+        offload_(std::bind(&BasicEventLoop::onWrite_, this, slot, gen), LANE_FAST);
+        return;
+    }
+    onWrite_(slot, gen);
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::sendResponse_(ConnectionSlot *slot, uint32_t gen)
+{
+    if (ioPool_ && !slot->conn.isFileResident())
+    {
+        /* 文件不在页缓存中，发送时会阻塞在缺页读盘上，先交给I/O线程读入 */
+        stats_.add(stats_.coldFiles);
+        if (isInLoopThread())
+        {
+            startPrefetch_(slot, gen);
+        }
+        else
+        {
+            queueInLoop(std::bind(&BasicEventLoop::startPrefetch_, this, slot, gen));
+        }
+        return;
+    }
+    // 发送缓冲区通常有空间，生成响应后直接发送，省掉一轮epoll_wait和一次线程切换；
+    // 只有内核返回EAGAIN时才注册EPOLLOUT
+    onWrite_(slot, gen);
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::onOffloadDone_(ConnectionSlot *slot, uint32_t gen)
+{
+    if (!takeBack_(slot, gen))
+    {
+        return;
+    }
+    sendResponse_(slot, gen);
+}
+
+template <typename Policy>
+bool BasicEventLoop<Policy>::takeBack_(ConnectionSlot *slot, uint32_t gen)
+{
+    slot->busy = false;
+    if (slot->closing)
+    {
+        slot->closing = false;
+        slot->conn.closeHttpConn();
+        return false;
+    }
+    return ConnectionSlab::isCurrent(slot, gen);
+}
+
+template <typename Policy>
+ssize_t BasicEventLoop<Policy>::readBuffer_(HttpConnection *client, int *saveErrno)
+{
+    if constexpr (Policy::trigger == TRIGGER_RUNTIME)
+    {
+        return client->readBuffer(saveErrno);
+    }
+    else
+    {
+        return client->template readBuffer<Policy::trigger == TRIGGER_ET, Log>(saveErrno);
+    }
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::receive_(void *ptr, int i)
+{
+    const char *data;
+    size_t len = poller_->getEventData(i, &data);
+    if (len == 0 || ptr == &listenFd_ || ptr == &wakeupFd_ || ptr == &timerFd_)
+    {
+        return;
+    }
+    ConnectionSlot *slot = static_cast<ConnectionSlot *>(ptr);
+    // 与read的时机保持一致: 请求还在处理或响应没有发完时不动读缓冲区
+    if (slot->busy || slot->conn.writeBytes() > 0 || !slot->received.empty())
+    {
+        slot->received.append(data, len);
+        return;
+    }
+    slot->conn.appendReadBuffer(data, len);
+}
+
+template <typename Policy>
+ssize_t BasicEventLoop<Policy>::writeBuffer_(HttpConnection *client, int *saveErrno)
+{
+    if constexpr (Policy::trigger == TRIGGER_RUNTIME)
+    {
+        return client->writeBuffer(saveErrno);
+    }
+    else
+    {
+        return client->template writeBuffer<Policy::trigger == TRIGGER_ET>(saveErrno);
+    }
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::resumeCo_(ConnectionSlot *slot, uint32_t gen, std::coroutine_handle<> h)
+{
+    h.resume();
+    if (ConnectionSlab::isCurrent(slot, gen) && slot->co.done())
+    {
+        closeConn_(slot, gen); /* 处理函数已经返回 */
+    }
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::waitIo_(ConnectionSlot *slot, std::coroutine_handle<> h, uint32_t events)
+{
+    slot->waiter = h;
+    slot->waitEvents = events;
+    if (!persistent_)
+    {
+        updateInterest_(slot, events);
+    }
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::onCoOffloaded_(ConnectionSlot *slot, uint32_t gen, std::coroutine_handle<> h,
+                                            std::coroutine_handle<> root)
+{
+    if (!takeBack_(slot, gen))
+    {
+        root.destroy(); /* 期间连接已经关闭，destroyConn_把帧留给这里释放 */
+        return;
+    }
+    resumeCo_(slot, gen, h);
+}
+
+template <typename Policy>
+void BasicEventLoop<Policy>::onWrite_(ConnectionSlot *slot, uint32_t gen)
+{
+    if (!ConnectionSlab::isCurrent(slot, gen))
+    {
+        return;
+    }
+    HttpConnection *client = &slot->conn;
+    int ret = -1;
+    int writeErrno = 0;
+    ret = writeBuffer_(client, &writeErrno);
+    if (client->writeBytes() == 0)
+    {
+        /* 传输完成 */
+        if (client->isKeepAlive())
+        {
+            if (persistent_ && (slot->deferredEvents & EPOLLIN))
+            {
+                /* 发送期间到达的数据还在socket里 */
+                slot->deferredEvents &= ~EPOLLIN;
+                onRead_(slot, gen);
+                return;
+            }
+            onProcess_(slot, gen);
+            return;
+        }
+    }
+    else if (ret > 0 || (ret < 0 && writeErrno == EAGAIN))
+    {
+        /* 发送缓冲区已满(或LT模式下本次只写了一部分)，等待EPOLLOUT继续传输 */
+        stats_.add(stats_.writeWaits);
+        updateInterest_(slot, EPOLLOUT);
+        return;
+    }
+    closeConn_(slot, gen);
+}
+
+#endif // EVENT_LOOP_H
@@ -0,0 +1,180 @@
+#ifndef LISTENER_H
+#define LISTENER_H
+
+#include <unistd.h> // close()
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h> // TCP_DEFER_ACCEPT, TCP_FASTOPEN
+#include <arpa/inet.h>
+
+#include "../spdlog/spdlog.h"
+
+// 监听socket的可调参数
+struct ListenOptions
+{
+    int backlog = 1024;     // listen()的全连接队列长度
+    int acceptBudget = 64;  // 每次唤醒最多accept的连接数，避免accept风暴饿死其他事件
+    int deferAcceptSec = 0; // >0时开启TCP_DEFER_ACCEPT，数据到达后才完成accept，单位秒
+    int fastOpenQueue = 0;  // >0时开启TCP_FASTOPEN，值为未完成握手的TFO请求队列长度
+};
+
+// 监听socket，负责创建、设置选项以及批量accept
+class Listener
+{
+public:
+    Listener(int port, bool optLinger, const ListenOptions &opts);
+    ~Listener();
+
+    Listener(const Listener &) = delete;
+    Listener &operator=(const Listener &) = delete;
+
+    // 创建socket并开始监听，reusePort为true时设置SO_REUSEPORT
+    bool listen(bool reusePort);
+
+    // 循环accept4直到队列为空或达到acceptBudget，
+    // onAccept(fd, addr)返回false时停止；返回值表示队列中可能还有未accept的连接
+    template <typename Handler>
+    bool acceptBatch(Handler &&onAccept);
+
+    int fd() const;
+    // TCP_DEFER_ACCEPT是否设置成功，即accept到的连接是否已经有数据可读
+    bool deferAccept() const;
+
+private:
+    bool setOption_(int level, int optname, const void *optval, socklen_t optlen, const char *name);
+
+    int port_;
+    int fd_;
+    bool openLinger_;
+    bool deferAccept_;
+    ListenOptions opts_;
+};
+
+Listener::Listener(int port, bool optLinger, const ListenOptions &opts)
+    : port_(port), fd_(-1), openLinger_(optLinger), deferAccept_(false), opts_(opts)
+{
+}
+
+Listener::~Listener()
+{
+    if (fd_ >= 0)
+    {
+        close(fd_);
+    }
+}
+
+int Listener::fd() const
+{
+    return fd_;
+}
+
+bool Listener::deferAccept() const
+{
+    return deferAccept_;
+}
+
+bool Listener::setOption_(int level, int optname, const void *optval, socklen_t optlen, const char *name)
+{
+    if (setsockopt(fd_, level, optname, optval, optlen) < 0)
+    {
+        spdlog::error("Set socket {} error: {}", name, strerror(errno));
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    return true;
+}
+
+bool Listener::listen(bool reusePort)
+{
+    struct sockaddr_in addr;
+
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port_);
+    struct linger optLinger = {0};
+    if (openLinger_)
+    {
+        /* 优雅关闭: 直到所剩数据发送完毕或超时 */
+        optLinger.l_onoff = 1;
+        optLinger.l_linger = 1;
+    }
+
+    fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0)
+    {
+        spdlog::error("Create socket error!");
+        return false;
+    }
+
+    if (!setOption_(SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger), "SO_LINGER"))
+        return false;
+
+    int optval = 1;
+    /* 端口复用 */
+    if (!setOption_(SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval), "SO_REUSEADDR"))
+        return false;
+    /* 多个loop各自监听同一端口 */
+    if (reusePort && !setOption_(SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval), "SO_REUSEPORT"))
+        return false;
+    /* DEFER_ACCEPT只是优化，设置失败时照常监听，连接仍等EPOLLIN再读取 */
+    if (opts_.deferAcceptSec > 0)
+    {
+        deferAccept_ = setsockopt(fd_, IPPROTO_TCP, TCP_DEFER_ACCEPT, &opts_.deferAcceptSec, sizeof(int)) == 0;
+        if (!deferAccept_)
+        {
+            spdlog::warn("Set socket TCP_DEFER_ACCEPT error: {}", strerror(errno));
+        }
+    }
+    if (opts_.fastOpenQueue > 0 &&
+        !setOption_(IPPROTO_TCP, TCP_FASTOPEN, &opts_.fastOpenQueue, sizeof(int), "TCP_FASTOPEN"))
+        return false;
+
+    if (bind(fd_, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        spdlog::error("Bind port {} error!", port_);
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    if (::listen(fd_, opts_.backlog) < 0)
+    {
+        spdlog::error("Listen port {} error!", port_);
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    return true;
+}
+
+template <typename Handler>
+bool Listener::acceptBatch(Handler &&onAccept)
+{
+    for (int i = 0; i < opts_.acceptBudget; ++i)
+    {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        int fd = accept4(fd_, (struct sockaddr *)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                spdlog::error("fd:{}===>accept error: {}", fd_, strerror(errno));
+            }
+            return false;
+        }
+        if (!onAccept(fd, addr))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif // LISTENER_H
@@ -0,0 +1,91 @@
+#ifndef LOOP_POLICY_H
+#define LOOP_POLICY_H
+
+#include <stddef.h>
+
+#include "../log/log_policy.h"
+#include "../epoller/default_poller.h"
+#include "../timer/default_timer.h"
+#include "../threadpool/default_pool.h"
+
+// 连接的触发模式
+enum TRIGGER_MODE
+{
+    TRIGGER_RUNTIME = 0, // 运行时按HttpConnection::isET选择
+    TRIGGER_LT,
+    TRIGGER_ET,
+};
+
+// 按虚函数投递，线程池的类型在运行时决定
+struct DynamicExecutor
+{
+    static Executor *newPool(size_t threadNumber, const PoolOptions &opts)
+    {
+        return newThreadPool(threadNumber, opts);
+    }
+
+    static void postBatch(Executor *pool, InlineTask *tasks, size_t n, int lane)
+    {
+        pool->postBatch(tasks, n, lane);
+    }
+};
+
+// 线程池的类型在编译期确定，投递时直接调用Pool的实现
+template <typename Pool>
+struct StaticExecutor
+{
+    static Executor *newPool(size_t threadNumber, const PoolOptions &opts)
+    {
+        return new Pool(threadNumber, opts);
+    }
+
+    static void postBatch(Executor *pool, InlineTask *tasks, size_t n, int lane)
+    {
+        static_cast<Pool *>(pool)->Pool::postBatch(tasks, n, lane);
+    }
+};
+
+// 事件循环的编译期配置: Poller和TimerQueue为具体类型(final)时调用不再经过虚表，
+// TRIGGER不是TRIGGER_RUNTIME时读写循环按固定的触发模式实例化，Log决定热路径上的info日志是否保留
+template <typename PollerT, typename TimerT, typename ExecutorT, int TRIGGER, typename LogT = SpdLog>
+struct LoopPolicy
+{
+    typedef PollerT PollerType;
+    typedef TimerT TimerType;
+    typedef ExecutorT ExecutorPolicy;
+    typedef LogT Log;
+    static const int trigger = TRIGGER;
+};
+
+// 与模板化之前的行为相同: 所有类型和触发模式都在运行时选择，也是唯一支持协程handler的配置
+typedef LoopPolicy<Poller, TimerQueue, DynamicExecutor, TRIGGER_RUNTIME> DynamicPolicy;
+
+// 创建策略指定的Poller，为基类时按type选择
+template <typename P>
+P *makePoller(int type)
+{
+    (void)type;
+    return new P();
+}
+
+template <>
+Poller *makePoller<Poller>(int type)
+{
+    return newPoller(type);
+}
+
+// 创建策略指定的TimerQueue，为基类时按type选择
+template <typename T>
+T *makeTimerQueue(int type)
+{
+    (void)type;
+    return new T();
+}
+
+template <>
+TimerQueue *makeTimerQueue<TimerQueue>(int type)
+{
+    return newTimerQueue(type);
+}
+
+#endif // LOOP_POLICY_H
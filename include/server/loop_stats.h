@@ -0,0 +1,111 @@
+#ifndef LOOP_STATS_H
+#define LOOP_STATS_H
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+#include "../spdlog/spdlog.h"
+
+// 事件循环中处理就绪事件的几类处理函数，用于分类统计耗时
+enum LOOP_HANDLER
+{
+    HANDLER_LISTEN = 0, // accept新连接
+    HANDLER_WAKEUP,     // eventfd: 接管新连接、执行queueInLoop的回调
+    HANDLER_TIMER,      // timerfd: 超时回调
+    HANDLER_READ,
+    HANDLER_WRITE,
+    HANDLER_CLOSE,      // EPOLLRDHUP/EPOLLHUP/EPOLLERR
+    HANDLER_FLUSH,      // 本轮事件处理完后向线程池批量投递任务
+    HANDLER_NUM,
+};
+
+// 事件循环的运行统计，工作线程也会累加，全部使用relaxed原子操作
+struct LoopStats
+{
+    std::atomic<uint64_t> requests{0};  // 生成的响应数
+    std::atomic<uint64_t> ctlCalls{0};  // 实际发出的事件注册/修改/删除次数(epoll_ctl或io_uring SQE)
+    std::atomic<uint64_t> ctlElided{0}; // 兴趣集合未变化而省掉的次数
+    std::atomic<uint64_t> writeWaits{0}; // 响应没能立即发完、需要等待EPOLLOUT的次数
+    std::atomic<uint64_t> timerElided{0}; // 只记录活跃时间、没有操作定时器的超时续期次数
+    std::atomic<uint64_t> timerRearms{0}; // 到期时发现连接仍活跃而重新加入定时器的次数
+    std::atomic<uint64_t> coldFiles{0};   // 响应文件不在页缓存中、先交给I/O线程读入的次数
+    std::atomic<uint64_t> pipelined{0};   // 与前一个响应合并到同一次writev发送的流水线响应数
+
+    std::atomic<uint64_t> iterations{0}; // 循环轮数(每次从wait返回算一轮)
+    std::atomic<uint64_t> events{0};     // 处理的就绪事件数
+    std::atomic<uint64_t> offloaded{0};      // 交给线程池的任务数
+    std::atomic<uint64_t> offloadBatches{0}; // 投递次数，通常每个通道每轮一次
+    // 以下只在LoopOptions::stallThresholdUS>0时统计
+    std::atomic<uint64_t> stalls{0};    // 单轮耗时超过阈值的次数
+    std::atomic<uint64_t> maxIterNS{0}; // 单轮最长耗时，每次输出后清零
+    std::atomic<uint64_t> handlerNS[HANDLER_NUM] = {};    // 各类处理的累计耗时
+    std::atomic<uint64_t> handlerCalls[HANDLER_NUM] = {}; // 各类处理的次数
+
+    void add(std::atomic<uint64_t> &counter, uint64_t n = 1)
+    {
+        counter.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    // 只由loop线程更新
+    void updateMax(std::atomic<uint64_t> &counter, uint64_t n)
+    {
+        if (n > counter.load(std::memory_order_relaxed))
+        {
+            counter.store(n, std::memory_order_relaxed);
+        }
+    }
+
+    static const char *handlerName(int handler);
+    std::string toString() const;
+};
+
+const char *LoopStats::handlerName(int handler)
+{
+    static const char *names[HANDLER_NUM + 1] = {"listen", "wakeup", "timer", "read", "write", "close", "flush", "none"};
+    return names[(handler >= 0 && handler < HANDLER_NUM) ? handler : HANDLER_NUM];
+}
+
+std::string LoopStats::toString() const
+{
+    uint64_t req = requests.load(std::memory_order_relaxed);
+    uint64_t ctl = ctlCalls.load(std::memory_order_relaxed);
+    uint64_t elided = ctlElided.load(std::memory_order_relaxed);
+    uint64_t waits = writeWaits.load(std::memory_order_relaxed);
+    uint64_t iter = iterations.load(std::memory_order_relaxed);
+    std::string res = fmt::format("requests:{} ctl:{} ctl_elided:{} ctl/request:{:.2f} write_waits:{} timer_elided:{} timer_rearms:{}",
+                                  req, ctl, elided, req ? static_cast<double>(ctl) / req : 0.0, waits,
+                                  timerElided.load(std::memory_order_relaxed), timerRearms.load(std::memory_order_relaxed));
+    res += fmt::format(" iterations:{} events/wakeup:{:.2f} stalls:{} max_iter_us:{}", iter,
+                       iter ? static_cast<double>(events.load(std::memory_order_relaxed)) / iter : 0.0,
+                       stalls.load(std::memory_order_relaxed), maxIterNS.load(std::memory_order_relaxed) / 1000);
+    uint64_t batches = offloadBatches.load(std::memory_order_relaxed);
+    if (batches)
+    {
+        uint64_t tasks = offloaded.load(std::memory_order_relaxed);
+        res += fmt::format(" offloaded:{} tasks/batch:{:.2f}", tasks, static_cast<double>(tasks) / batches);
+    }
+    uint64_t cold = coldFiles.load(std::memory_order_relaxed);
+    if (cold)
+    {
+        res += fmt::format(" cold_files:{}", cold);
+    }
+    uint64_t piped = pipelined.load(std::memory_order_relaxed);
+    if (piped)
+    {
+        res += fmt::format(" pipelined:{}", piped);
+    }
+    for (int i = 0; i < HANDLER_NUM; ++i)
+    {
+        uint64_t calls = handlerCalls[i].load(std::memory_order_relaxed);
+        if (calls)
+        {
+            /* 累计耗时(微秒)/平均每次耗时(纳秒) */
+            uint64_t ns = handlerNS[i].load(std::memory_order_relaxed);
+            res += fmt::format(" {}:{}us/{}ns", handlerName(i), ns / 1000, ns / calls);
+        }
+    }
+    return res;
+}
+
+#endif // LOOP_STATS_H
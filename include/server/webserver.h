@@ -2,8 +2,8 @@
 #ifndef WEBSERVER_H
 #define WEBSERVER_H
 
-#include <unordered_map>
-#include <fcntl.h>  // fcntl()
+#include <vector>
+#include <thread>
 #include <unistd.h> // close()
 #include <assert.h>
 #include <errno.h>
@@ -15,65 +15,140 @@
 
 
 #include "../spdlog/spdlog.h"
-#include "../epoller/epoller.h"
-#include "../threadpool/thread_pool.h"
+#include "../threadpool/default_pool.h"
 #include "../http/http_connection.h"
-#include "../timer/timer.h"
 #include "../db/skiplist.h"
+#include "loop_policy.h"
+#include "event_loop.h"
+#include "co_connection.h"
+#include "listener.h"
+#include "../topology/cpu_topology.h"
+
+// 各种策略组合的服务器共同的接口，由TaoWebserver持有
+class WebserverBase
+{
+public:
+    virtual ~WebserverBase() = default;
+    virtual void run() = 0;
+    // 初始化(监听socket、各个loop的poller等)是否成功
+    virtual bool isValid() const = 0;
+};
 
+// 对外使用的服务器: 构造时按参数选出一个编译期特化的BasicWebserver，
+// 不在常用组合中的配置和协程模式使用DynamicPolicy，行为与各项都在运行时选择时相同。
+// 热路径上info日志的去留也在构造时按当时的日志级别确定: 级别高于info时这些日志在编译期去掉，
+// 之后再调低级别对它们不起作用(启动、统计和warn/error日志不受影响)，需要时应在构造前设置好级别。
+// 选中io_uring的特化组合而某个loop的io_uring初始化失败时，整体改用epoll重新构造
 class TaoWebserver
 {
 public:
-    TaoWebserver(int port, int trigMode, int timeoutMS, bool optLinger, int threadNum);
-    ~TaoWebserver();
+    // 多reactor模式下新连接的分发方式
+    enum ACCEPT_MODE
+    {
+        REUSEPORT_LISTENER = 0, // 每个loop一个SO_REUSEPORT监听socket，由内核分发
+        SINGLE_ACCEPTOR,        // 单个acceptor accept后通过eventfd交给其他loop
+    };
+
+    // threadNum或loopNum<=0时根据CPU拓扑自动选择
+    TaoWebserver(int port, int trigMode, int timeoutMS, bool optLinger, int threadNum,
+                 int loopNum = 1, int acceptMode = REUSEPORT_LISTENER, int pollerType = EPOLL_POLLER,
+                 const ListenOptions &listenOpts = ListenOptions(), const LoopOptions &loopOpts = LoopOptions(),
+                 const PoolOptions &poolOpts = PoolOptions(), const PlacementOptions &placement = PlacementOptions());
 
     void run(); // 一切的开始
 
-private:
-    // 对服务端的socket进行设置，最后可以得到listenFd
-    bool initSocket_();
+    // 由触发模式和LoopOptions得到监听socket和连接注册的事件
+    static void eventMode(int trigMode, const LoopOptions &loopOpts, uint32_t *listenEvent, uint32_t *connectionEvent);
 
-    void initEventMode_(int trigMode);
+private:
+    typedef WebserverBase *(*Factory)(int port, int trigMode, int timeoutMS, bool optLinger, int threadNum,
+                                      int loopNum, int acceptMode, int pollerType, const ListenOptions &listenOpts,
+                                      const LoopOptions &loopOpts, const PoolOptions &poolOpts,
+                                      const PlacementOptions &placement);
+
+    template <typename Policy>
+    static WebserverBase *create_(int port, int trigMode, int timeoutMS, bool optLinger, int threadNum, int loopNum,
+                                  int acceptMode, int pollerType, const ListenOptions &listenOpts,
+                                  const LoopOptions &loopOpts, const PoolOptions &poolOpts,
+                                  const PlacementOptions &placement);
+    // 按构造时的日志级别选择热路径上的日志策略，之后改变级别不会重新选择
+    template <typename P, typename T, typename E, int TRIGGER>
+    static Factory withLog_();
+    // 实例化的常用组合，*name为选中组合的说明
+    static Factory chooseServer_(int trigMode, int pollerType, const LoopOptions &loopOpts,
+                                 const PoolOptions &poolOpts, const char **name);
+
+    std::unique_ptr<WebserverBase> server_;
+};
 
-    void addClientConnection(int fd, sockaddr_in addr); // 添加一个HTTP连接
-    void closeConn_(HttpConnection *client);            // 关闭一个HTTP连接
+// 服务器的实现，Policy见loop_policy.h。
+// 策略中的类型是具体类型时以策略为准，pollerType、LoopOptions::timerType和PoolOptions::type不再起作用；
+// 触发模式由trigMode决定，与策略不一致或在非DynamicPolicy下设置了协程handler时拒绝启动
+template <typename Policy>
+class BasicWebserver : public WebserverBase
+{
+public:
+    typedef BasicEventLoop<Policy> Loop;
 
-    void handleListen_();
-    void handleWrite_(HttpConnection *client);
-    void handleRead_(HttpConnection *client);
+    BasicWebserver(int port, int trigMode, int timeoutMS, bool optLinger, int threadNum,
+                   int loopNum = 1, int acceptMode = TaoWebserver::REUSEPORT_LISTENER, int pollerType = EPOLL_POLLER,
+                   const ListenOptions &listenOpts = ListenOptions(), const LoopOptions &loopOpts = LoopOptions(),
+                   const PoolOptions &poolOpts = PoolOptions(),
+                   const PlacementOptions &placement = PlacementOptions());
+    ~BasicWebserver() override;
 
-    void onRead_(HttpConnection *client);
-    void onWrite_(HttpConnection *client);
-    void onProcess_(HttpConnection *client);
+    void run() override;
+    bool isValid() const override;
 
-    void sendError_(int fd, const char *info);
-    void extentTime_(HttpConnection *client);
+private:
+    // 创建监听socket并交给对应的loop
+    bool initListener_(Loop *loop, bool reusePort);
+    bool initLoops_();
+    // 根据拓扑确定线程数和绑定的CPU
+    void initPlacement_(int threadNum, PoolOptions *poolOpts);
 
-    static const int MAX_FD = 65536;
-    static int setFdNonblock(int fd);
+    bool initEventMode_(int trigMode);
 
     int port_;
     int timeoutMS_; /* 毫秒MS,定时器的默认过期时间 */
     bool isClose_;
-    int listenFd_;
     bool openLinger_;
+    int loopNum_;
+    int acceptMode_;
+    int pollerType_; // EPOLL_POLLER或URING_POLLER
     char *srcDir_; // 需要获取的路径
 
     uint32_t listenEvent_;
     uint32_t connectionEvent_;
 
-    std::unique_ptr<HeapTimer> timer_;
-    std::unique_ptr<ThreadPool> threadpool_;
-    std::unique_ptr<Epoller> epoller_;
+    ListenOptions listenOpts_;
+    LoopOptions loopOpts_;
+    PlacementOptions placement_;
+    CpuTopology topology_;
+    std::vector<int> loopCpus_; // 为空时不绑定
+    std::vector<std::unique_ptr<Listener>> listeners_;
+    std::vector<std::unique_ptr<ConnectionSlab>> slabs_; // 每个loop一个，需要比线程池活得更久
+    std::unique_ptr<Executor> threadpool_; // 析构时在loops_之前显式释放
+    std::unique_ptr<Executor> ioPool_; // 读入冷文件，LoopOptions::ioThreads>0时创建，同样先于loops_释放
+    std::vector<std::unique_ptr<Loop>> loops_; // loops_[0]在调用run()的线程中运行
+    std::vector<std::thread> loopThreads_;
     std::unique_ptr<SkipList<std::string,std::string>> db_sk;
-    std::unordered_map<int, HttpConnection> users_;
 };
 
 
-TaoWebserver::TaoWebserver(
-    int port, int trigMode, int timeoutMS, bool optLinger, int threadNum) : port_(port), openLinger_(optLinger), timeoutMS_(timeoutMS), isClose_(false),
-                                                                            timer_(new HeapTimer()), threadpool_(new ThreadPool(threadNum)), epoller_(new Epoller()),db_sk(new SkipList<std::string,std::string>(4))
+template <typename Policy>
+BasicWebserver<Policy>::BasicWebserver(
+    int port, int trigMode, int timeoutMS, bool optLinger, int threadNum, int loopNum, int acceptMode, int pollerType,
+    const ListenOptions &listenOpts, const LoopOptions &loopOpts, const PoolOptions &poolOpts,
+    const PlacementOptions &placement)
+    : port_(port), timeoutMS_(timeoutMS), isClose_(false), openLinger_(optLinger),
+      loopNum_(loopNum), acceptMode_(acceptMode), pollerType_(pollerType), listenOpts_(listenOpts),
+      loopOpts_(loopOpts), placement_(placement),
+      db_sk(new SkipList<std::string,std::string>(4))
 {
+    PoolOptions opts = poolOpts;
+    initPlacement_(threadNum, &opts);
+
     // 获取当前工作目录的绝对路径
     srcDir_ = getcwd(nullptr, 256);
 
@@ -81,9 +156,9 @@ TaoWebserver::TaoWebserver(
     strncat(srcDir_, "/resources/", 16);
     HttpConnection::userCount = 0;
     HttpConnection::srcDir = srcDir_;
+    HttpRequest::maxBodyBytes = loopOpts_.maxBodyBytes;
 
-    initEventMode_(trigMode);
-    if (!initSocket_())
+    if (!initEventMode_(trigMode) || !initLoops_())
         isClose_ = true;
 
     //添加两个可以登录系统的默认账号
@@ -91,299 +166,308 @@ TaoWebserver::TaoWebserver(
     db_sk->insert("admin","123456");
 }
 
-TaoWebserver::~TaoWebserver()
+template <typename Policy>
+BasicWebserver<Policy>::~BasicWebserver()
 {
-    close(listenFd_);
     isClose_ = true;
+    for (auto &loop : loops_)
+    {
+        loop->stop();
+    }
+    for (auto &t : loopThreads_)
+    {
+        t.join();
+    }
+    // 线程池中还在执行的任务会通过queueInLoop或交回busy的槽回调loop，
+    // 成员按声明的逆序析构时loops_先于线程池释放，这里先等线程池退出
+    ioPool_.reset();
+    threadpool_.reset();
     free(srcDir_);
 }
 
-void TaoWebserver::initEventMode_(int trigMode)
+template <typename Policy>
+void BasicWebserver<Policy>::initPlacement_(int threadNum, PoolOptions *poolOpts)
 {
-    listenEvent_ = EPOLLRDHUP;
-    connectionEvent_ = EPOLLONESHOT | EPOLLRDHUP;
-    switch (trigMode)
+    bool needTopology = loopNum_ <= 0 || threadNum <= 0 || placement_.pinLoops || placement_.pinWorkers;
+    if (needTopology && !topology_.load())
     {
-    case 0:
-        break;
-    case 1:
-        connectionEvent_ |= EPOLLET;
-        break;
-    case 2:
-        listenEvent_ |= EPOLLET;
-        break;
-    case 3:
-        listenEvent_ |= EPOLLET;
-        connectionEvent_ |= EPOLLET;
-        break;
-    default:
-        listenEvent_ |= EPOLLET;
-        connectionEvent_ |= EPOLLET;
-        break;
+        spdlog::warn("read cpu topology failed, use defaults without pinning.");
+        needTopology = false;
     }
-    HttpConnection::isET = (connectionEvent_ & EPOLLET);
-}
-
-void TaoWebserver::run()
-{
-    int timeMS = -1; // epoll wtimeout==-1 就是无事件一直阻塞wait
-    if (!isClose_)
+    if (needTopology)
     {
-        std::string art = R"(
-  _____  _    ___  
- |_   _|/ \  / _ \ 
-   | | / _ \| | | |
-   | |/ ___ \ |_| |
-   |_/_/   \_\___/ 
-        )";
-
-        spdlog::info(art);
+        spdlog::info("cpu topology: {}", topology_.toString());
     }
-    while (!isClose_)
+    if (loopNum_ <= 0)
     {
-        if (timeoutMS_ > 0)
-        {
-            timeMS = timer_->getNextTrick();
-        }
-        int eventCnt = epoller_->wait(timeMS);
-        for (int i = 0; i < eventCnt; ++i)
-        {
-            int fd = epoller_->getEventFd(i);
-            uint32_t events = epoller_->getEvents(i);
-
-            if (fd == listenFd_)
-            {
-                spdlog::info("fd:{}===>HandleListen", fd);
-                handleListen_();
-            }
-            else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
-            {
-                spdlog::info("fd:{}===>EPOLLRDHUP | EPOLLHUP | EPOLLERR", fd);
-                closeConn_(&users_[fd]);
-            }
-            else if (events & EPOLLIN)
-            {
-                spdlog::info("fd:{}===>EPOLLIN", fd);
-                handleRead_(&users_[fd]);
-            }
-            else if (events & EPOLLOUT)
-            {
-                spdlog::info("fd:{}===>EPOLLOUT", fd);
-                handleWrite_(&users_[fd]);
-            }
-            else
-            {
-                spdlog::info("fd:{}===>Unexpected event", fd);
-            }
-        }
+        loopNum_ = needTopology ? topology_.suggestLoops(loopOpts_.runToCompletion) : 1;
     }
-}
-
-void TaoWebserver::sendError_(int fd, const char *info)
-{
-    assert(fd > 0);
-    int ret = send(fd, info, strlen(info), 0);
-    if (ret < 0)
+    if (threadNum <= 0)
     {
-        spdlog::info("fd:{}===>send error to client unsuccessful.", fd);
+        threadNum = needTopology ? topology_.suggestWorkers(loopNum_) : 4;
+    }
+    if (needTopology && placement_.pinLoops)
+    {
+        loopCpus_ = topology_.loopCpus(loopNum_);
+    }
+    if (needTopology && placement_.pinWorkers)
+    {
+        /* loop也绑定时避开loop占用的CPU */
+        poolOpts->cpus = topology_.workerCpus(loopCpus_.empty() ? 0 : loopNum_);
+    }
+    spdlog::info("event loops: {}, worker threads: {}, pin loops: {}, pin workers: {}", loopNum_, threadNum,
+                 !loopCpus_.empty(), !poolOpts->cpus.empty());
+    threadpool_.reset(Policy::ExecutorPolicy::newPool(threadNum, *poolOpts));
+    if (loopOpts_.ioThreads > 0)
+    {
+        /* I/O线程大部分时间阻塞在读盘上，不绑定CPU */
+        spdlog::info("cold file io threads: {}", loopOpts_.ioThreads);
+        ioPool_.reset(new ThreadPool(loopOpts_.ioThreads));
     }
-    close(fd);
 }
 
-void TaoWebserver::closeConn_(HttpConnection *client)
+template <typename Policy>
+bool BasicWebserver<Policy>::initEventMode_(int trigMode)
 {
-    assert(client);
-    spdlog::info("fd:{}===>Client quit.", client->getFd());
-    epoller_->delFd(client->getFd());
-    client->closeHttpConn();
+    TaoWebserver::eventMode(trigMode, loopOpts_, &listenEvent_, &connectionEvent_);
+    if (!loopOpts_.oneShot && (connectionEvent_ & EPOLLONESHOT))
+    {
+        spdlog::warn("non-oneshot mode requires run-to-completion, keep EPOLLONESHOT.");
+    }
+    bool et = connectionEvent_ & EPOLLET;
+    if (Policy::trigger != TRIGGER_RUNTIME && et != (Policy::trigger == TRIGGER_ET))
+    {
+        spdlog::error("trigger mode {} does not match the compiled loop policy!", trigMode);
+        return false;
+    }
+    if (loopOpts_.handler && !Loop::COROUTINES)
+    {
+        spdlog::error("coroutine handler requires the dynamic loop policy!");
+        return false;
+    }
+    HttpConnection::isET = et;
+    return true;
 }
 
-void TaoWebserver::addClientConnection(int fd, sockaddr_in addr)
+template <typename Policy>
+bool BasicWebserver<Policy>::initLoops_()
 {
-    assert(fd > 0);
-    users_[fd].initHttpConn(fd, addr);
-    if (timeoutMS_ > 0)
+    std::vector<Loop *> peers;
+    for (int i = 0; i < loopNum_; ++i)
     {
-        timer_->addHeapTimer(fd, timeoutMS_, std::bind(&TaoWebserver::closeConn_, this, &users_[fd]));
+        slabs_.emplace_back(new ConnectionSlab(Loop::MAX_FD));
+        loops_.emplace_back(new Loop(i, timeoutMS_, listenEvent_, connectionEvent_, threadpool_.get(), slabs_.back().get(), pollerType_, loopOpts_));
+        if (!loops_.back()->isValid())
+        {
+            spdlog::error("loop:{}===>init failed with poller {}!", i, pollerType_ == URING_POLLER ? "io_uring" : "epoll");
+            return false;
+        }
+        loops_.back()->setIoPool(ioPool_.get());
+        if (!loopCpus_.empty())
+        {
+            loops_.back()->setCpu(loopCpus_[i]);
+        }
+        peers.push_back(loops_.back().get());
     }
-    epoller_->addFd(fd, EPOLLIN | connectionEvent_);
-    setFdNonblock(fd);
-}
 
-void TaoWebserver::handleListen_()
-{
-    struct sockaddr_in addr;
-    socklen_t len = sizeof(addr);
-    do
+    if (acceptMode_ == TaoWebserver::SINGLE_ACCEPTOR || loopNum_ == 1)
     {
-        int fd = accept(listenFd_, (struct sockaddr *)&addr, &len);
-        if (fd <= 0)
+        /* 单个acceptor: loops_[0]负责accept，再轮询分发给所有loop */
+        if (!initListener_(loops_[0].get(), false))
+            return false;
+        if (loopNum_ > 1)
         {
-            return;
+            loops_[0]->setPeers(peers);
+            /* 连接在各自的loop中建立，都按acceptor的监听socket决定是否直接读取 */
+            for (auto &loop : loops_)
+            {
+                loop->setDeferAccept(listeners_.front()->deferAccept());
+            }
         }
-        else if (HttpConnection::userCount >= MAX_FD)
+    }
+    else
+    {
+        /* SO_REUSEPORT: 每个loop各自监听同一端口，由内核做负载均衡 */
+        for (auto &loop : loops_)
         {
-            sendError_(fd, "Server busy!");
-            spdlog::info("Clients is full");
-            return;
+            if (!initListener_(loop.get(), true))
+                return false;
         }
-        addClientConnection(fd, addr);
-    } while (listenEvent_ & EPOLLET);
+    }
+    spdlog::info("Server port: {}, event loops: {}, accept mode: {}, backlog: {}", port_, loopNum_,
+                 acceptMode_ == TaoWebserver::SINGLE_ACCEPTOR ? "single acceptor" : "SO_REUSEPORT",
+                 listenOpts_.backlog);
+    return true;
 }
 
-void TaoWebserver::handleRead_(HttpConnection *client)
+template <typename Policy>
+void BasicWebserver<Policy>::run()
 {
-   
-    extentTime_(client);
-    threadpool_->submit(std::bind(&TaoWebserver::onRead_, this, client));
+    if (!isClose_)
+    {
+        std::string art = R"(
+  _____  _    ___  
+ |_   _|/ \  / _ \ 
+   | | / _ \| | | |
+   | |/ ___ \ |_| |
+   |_/_/   \_\___/ 
+        )";
+
+        spdlog::info(art);
+    }
+    else
+    {
+        return;
+    }
+    for (size_t i = 1; i < loops_.size(); ++i)
+    {
+        Loop *loop = loops_[i].get();
+        loopThreads_.emplace_back([loop]()
+                                  { loop->loop(); });
+    }
+    loops_[0]->loop();
 }
 
-void TaoWebserver::handleWrite_(HttpConnection *client)
+template <typename Policy>
+bool BasicWebserver<Policy>::isValid() const
 {
-    
-    extentTime_(client);
-    threadpool_->submit(std::bind(&TaoWebserver::onWrite_, this, client));
+    return !isClose_;
 }
 
-void TaoWebserver::extentTime_(HttpConnection *client)
+template <typename Policy>
+bool BasicWebserver<Policy>::initListener_(Loop *loop, bool reusePort)
 {
-  
-    if (timeoutMS_ > 0)
+    listeners_.emplace_back(new Listener(port_, openLinger_, listenOpts_));
+    Listener *listener = listeners_.back().get();
+    if (!listener->listen(reusePort) || !loop->setListener(listener))
     {
-        timer_->update(client->getFd(), timeoutMS_);
+        return false;
     }
+    // 只有TCP_DEFER_ACCEPT确实生效时，新连接才能不等EPOLLIN直接读取
+    loop->setDeferAccept(listener->deferAccept());
+    return true;
 }
 
-void TaoWebserver::onRead_(HttpConnection *client)
+TaoWebserver::TaoWebserver(
+    int port, int trigMode, int timeoutMS, bool optLinger, int threadNum, int loopNum, int acceptMode, int pollerType,
+    const ListenOptions &listenOpts, const LoopOptions &loopOpts, const PoolOptions &poolOpts,
+    const PlacementOptions &placement)
 {
-    
-    int ret = -1;
-    int readErrno = 0;
-    ret = client->readBuffer(&readErrno);
-   
-    if (ret <= 0 && readErrno != EAGAIN)
+    const char *name = nullptr;
+    Factory factory = chooseServer_(trigMode, pollerType, loopOpts, poolOpts, &name);
+    spdlog::info("server pipeline: {}", name);
+    server_.reset(factory(port, trigMode, timeoutMS, optLinger, threadNum, loopNum, acceptMode, pollerType,
+                          listenOpts, loopOpts, poolOpts, placement));
+    if (!server_->isValid() && pollerType == URING_POLLER)
     {
-
-        spdlog::error("fd:{}===>do not read data!",client->getFd());
-        closeConn_(client);
-        return;
+        // 探测之后仍可能失败(如多个loop的ring超出RLIMIT_MEMLOCK)，特化组合中Poller是固定的，只能整体重建
+        spdlog::warn("io_uring setup failed in an event loop, fall back to epoll.");
+        server_.reset(); /* 先释放监听端口 */
+        factory = chooseServer_(trigMode, EPOLL_POLLER, loopOpts, poolOpts, &name);
+        spdlog::info("server pipeline: {}", name);
+        server_.reset(factory(port, trigMode, timeoutMS, optLinger, threadNum, loopNum, acceptMode, EPOLL_POLLER,
+                              listenOpts, loopOpts, poolOpts, placement));
     }
-    onProcess_(client);
 }
 
-void TaoWebserver::onProcess_(HttpConnection *client)
+void TaoWebserver::run()
 {
-    if (client->handleHttpConn())
-    {
-        epoller_->modFd(client->getFd(), connectionEvent_ | EPOLLOUT);
-    }
-    else
-    {
-        epoller_->modFd(client->getFd(), connectionEvent_ | EPOLLIN);
-    }
+    server_->run();
 }
 
-void TaoWebserver::onWrite_(HttpConnection *client)
+void TaoWebserver::eventMode(int trigMode, const LoopOptions &loopOpts, uint32_t *listenEvent,
+                             uint32_t *connectionEvent)
 {
-   
-    int ret = -1;
-    int writeErrno = 0;
-    ret = client->writeBuffer(&writeErrno);
-    if (client->writeBytes() == 0)
+    *listenEvent = EPOLLRDHUP;
+    *connectionEvent = EPOLLONESHOT | EPOLLRDHUP;
+    switch (trigMode)
     {
-        /* 传输完成 */
-        if (client->isKeepAlive())
-        {
-            onProcess_(client);
-            return;
-        }
+    case 0:
+        break;
+    case 1:
+        *connectionEvent |= EPOLLET;
+        break;
+    case 2:
+        *listenEvent |= EPOLLET;
+        break;
+    case 3:
+        *listenEvent |= EPOLLET;
+        *connectionEvent |= EPOLLET;
+        break;
+    default:
+        *listenEvent |= EPOLLET;
+        *connectionEvent |= EPOLLET;
+        break;
     }
-    else if (ret < 0)
+    // 不带ONESHOT时同一连接的事件可能被并发处理，只有run-to-completion或协程模式能保证归属
+    if (!loopOpts.oneShot && (loopOpts.runToCompletion || loopOpts.handler))
     {
-        if (writeErrno == EAGAIN)
-        {
-            /* 继续传输 */
-            epoller_->modFd(client->getFd(), connectionEvent_ | EPOLLOUT);
-            return;
-        }
+        *connectionEvent = EPOLLRDHUP | EPOLLET;
     }
-    closeConn_(client);
 }
 
-bool TaoWebserver::initSocket_()
+template <typename Policy>
+WebserverBase *TaoWebserver::create_(int port, int trigMode, int timeoutMS, bool optLinger, int threadNum, int loopNum,
+                                     int acceptMode, int pollerType, const ListenOptions &listenOpts,
+                                     const LoopOptions &loopOpts, const PoolOptions &poolOpts,
+                                     const PlacementOptions &placement)
 {
-    int ret;
-    struct sockaddr_in addr;
-    
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(port_);
-    struct linger optLinger = {0};
-    if (openLinger_)
-    {
-        /* 优雅关闭: 直到所剩数据发送完毕或超时 */
-        optLinger.l_onoff = 1;
-        optLinger.l_linger = 1;
-    }
-
-    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (listenFd_ < 0)
-    {
-        spdlog::error("Create socket error!");
-        return false;
-    }
+    return new BasicWebserver<Policy>(port, trigMode, timeoutMS, optLinger, threadNum, loopNum, acceptMode,
+                                      pollerType, listenOpts, loopOpts, poolOpts, placement);
+}
 
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
-    if (ret < 0)
+template <typename P, typename T, typename E, int TRIGGER>
+TaoWebserver::Factory TaoWebserver::withLog_()
+{
+    // 日志级别高于info时热路径上的info日志在编译期去掉，之后再调低级别也不会输出
+    if (!spdlog::should_log(spdlog::level::info))
     {
-        close(listenFd_);
-        spdlog::error("Init linger error!");
-        return false;
+        return &create_<LoopPolicy<P, T, E, TRIGGER, QuietLog>>;
     }
+    return &create_<LoopPolicy<P, T, E, TRIGGER, SpdLog>>;
+}
 
-    int optval = 1;
-    /* 端口复用 */
-    /* 只有最后一个套接字会正常接收数据。 */
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, (const void *)&optval, sizeof(int));
-    if (ret == -1)
+TaoWebserver::Factory TaoWebserver::chooseServer_(int trigMode, int pollerType, const LoopOptions &loopOpts,
+                                                  const PoolOptions &poolOpts, const char **name)
+{
+    *name = "dynamic";
+    if (loopOpts.handler)
     {
-        spdlog::error("Set socket setsockopt error!");
-        close(listenFd_);
-        return false;
+        return &create_<DynamicPolicy>;
     }
-
-    ret = bind(listenFd_, (struct sockaddr *)&addr, sizeof(addr));
-    if (ret < 0)
+    uint32_t listenEvent, connectionEvent;
+    eventMode(trigMode, loopOpts, &listenEvent, &connectionEvent);
+    bool et = connectionEvent & EPOLLET;
+    bool wheel = loopOpts.timerType == TIMING_WHEEL;
+    bool stealing = poolOpts.type == WORK_STEALING_POOL;
+    if (pollerType == URING_POLLER)
     {
-        spdlog::error("Bind port {} error!");
-        close(listenFd_);
-        return false;
+        if (!UringPoller().isValid())
+        {
+            spdlog::warn("io_uring setup failed, fall back to epoll.");
+        }
+        else if (et && wheel && stealing)
+        {
+            *name = "io_uring + ET + timing wheel + work stealing";
+            return withLog_<UringPoller, TimingWheel, StaticExecutor<WorkStealingPool>, TRIGGER_ET>();
+        }
+        else
+        {
+            return &create_<DynamicPolicy>;
+        }
     }
-
-    ret = listen(listenFd_, 6);
-    if (ret < 0)
+    if (et && wheel && stealing)
     {
-        spdlog::error("Listen port {} error!",port_);
-        close(listenFd_);
-        return false;
+        *name = "epoll + ET + timing wheel + work stealing";
+        return withLog_<Epoller, TimingWheel, StaticExecutor<WorkStealingPool>, TRIGGER_ET>();
     }
-    ret = epoller_->addFd(listenFd_, listenEvent_ | EPOLLIN);
-    if (ret == 0)
+    if (!wheel && !stealing)
     {
-        spdlog::error("Add listenevent to epoll error!",port_);
-        close(listenFd_);
-        return false;
+        *name = et ? "epoll + ET + heap timer + thread pool" : "epoll + LT + heap timer + thread pool";
+        return et ? withLog_<Epoller, HeapTimer, StaticExecutor<ThreadPool>, TRIGGER_ET>()
+                  : withLog_<Epoller, HeapTimer, StaticExecutor<ThreadPool>, TRIGGER_LT>();
     }
-    setFdNonblock(listenFd_);
-    spdlog::info("Server port: {}",port_);
-    return true;
+    return &create_<DynamicPolicy>;
 }
 
-int TaoWebserver::setFdNonblock(int fd)
-{
-    
-    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFD, 0) | O_NONBLOCK);
-}
-
-
-#endif // WEBSERVER_H
\ No newline at end of file
+#endif // WEBSERVER_H
@@ -0,0 +1,17 @@
+#ifndef DEFAULT_POOL_H
+#define DEFAULT_POOL_H
+
+#include "thread_pool.h"
+#include "work_stealing_pool.h"
+
+// 按照类型创建线程池
+Executor *newThreadPool(size_t threadNumber, const PoolOptions &opts = PoolOptions())
+{
+    if (opts.type == WORK_STEALING_POOL)
+    {
+        return new WorkStealingPool(threadNumber, opts);
+    }
+    return new ThreadPool(threadNumber, opts);
+}
+
+#endif // DEFAULT_POOL_H
@@ -0,0 +1,47 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <stddef.h>
+#include <future>
+#include <functional>
+#include <memory>
+
+#include "inline_task.h"
+#include "pool_stats.h"
+
+// 线程池的公共接口，ThreadPool和WorkStealingPool各自实现投递和统计
+// 事件循环只持有Executor指针，编译期确定类型时由StaticExecutor直接调用具体实现
+class Executor
+{
+public:
+    Executor() = default;
+    Executor(const Executor &) = delete;
+    Executor &operator=(const Executor &) = delete;
+    virtual ~Executor() = default;
+
+    // 投递一个任务到lane通道
+    virtual void postTask(InlineTask &&task, int lane = LANE_FAST) = 0;
+    // 一次向lane通道投递n个任务(移走tasks中的内容)
+    virtual void postBatch(InlineTask *tasks, size_t n, int lane = LANE_FAST) = 0;
+    virtual const PoolStats &stats() const = 0;
+
+    // 需要拿到返回值时使用，每次提交会分配packaged_task和共享状态
+    template <typename F, typename... Args>
+    auto submit(F &&f, Args &&...args) -> std::future<decltype(f(args...))>
+    {
+        auto taskPtr = std::make_shared<std::packaged_task<decltype(f(args...))()>>(
+            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+        postTask(InlineTask([taskPtr]()
+                            { (*taskPtr)(); }));
+        return taskPtr->get_future();
+    }
+
+    // 投递一个不需要返回值的任务到lane通道，可调用对象内联存放在任务对象中，不分配内存
+    template <typename F>
+    void execute(F &&f, int lane = LANE_FAST)
+    {
+        postTask(InlineTask(std::forward<F>(f)), lane);
+    }
+};
+
+#endif // EXECUTOR_H
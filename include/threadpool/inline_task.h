@@ -0,0 +1,101 @@
+#ifndef INLINE_TASK_H
+#define INLINE_TASK_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+// 定长、内联存储的可调用对象，用于不需要返回值的任务
+// 和std::function不同，可调用对象直接构造在内部缓冲区中，超过CAPACITY时编译报错而不是退回堆分配，
+// 因此构造和移动都不会分配内存。只能移动，不能复制
+class InlineTask
+{
+public:
+    static const size_t CAPACITY = 40; // 足够放下成员函数指针+this+两个参数的std::bind
+
+    InlineTask() : ops_(nullptr) {}
+
+    template <typename F, typename Fn = typename std::decay<F>::type,
+              typename = typename std::enable_if<!std::is_same<Fn, InlineTask>::value>::type>
+    InlineTask(F &&f) : ops_(&opsOf_<Fn>())
+    {
+        static_assert(sizeof(Fn) <= CAPACITY, "callable too large for InlineTask");
+        static_assert(alignof(Fn) <= alignof(void *), "callable over-aligned for InlineTask");
+        static_assert(std::is_nothrow_move_constructible<Fn>::value, "callable must be nothrow movable");
+        new (storage_) Fn(std::forward<F>(f));
+    }
+
+    InlineTask(InlineTask &&other) noexcept : ops_(other.ops_)
+    {
+        if (ops_)
+        {
+            ops_->move(storage_, other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    InlineTask &operator=(InlineTask &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            if (other.ops_)
+            {
+                ops_ = other.ops_;
+                ops_->move(storage_, other.storage_);
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    InlineTask(const InlineTask &) = delete;
+    InlineTask &operator=(const InlineTask &) = delete;
+
+    ~InlineTask() { reset(); }
+
+    void operator()() { ops_->invoke(storage_); }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    void reset()
+    {
+        if (ops_)
+        {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    // 每种可调用类型一张函数表，代替虚函数
+    struct Ops
+    {
+        void (*invoke)(void *);
+        void (*move)(void *dst, void *src); // 移动构造到dst并析构src
+        void (*destroy)(void *);
+    };
+
+    template <typename Fn>
+    static const Ops &opsOf_()
+    {
+        static const Ops ops = {
+            [](void *p)
+            { (*static_cast<Fn *>(p))(); },
+            [](void *dst, void *src)
+            {
+                new (dst) Fn(std::move(*static_cast<Fn *>(src)));
+                static_cast<Fn *>(src)->~Fn();
+            },
+            [](void *p)
+            { static_cast<Fn *>(p)->~Fn(); },
+        };
+        return ops;
+    }
+
+    alignas(void *) unsigned char storage_[CAPACITY]; // 按指针对齐，对象共48字节，和入队时间、队列格子序号一起正好占一个缓存行
+    const Ops *ops_;
+};
+
+#endif // INLINE_TASK_H
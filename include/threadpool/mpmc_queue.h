@@ -0,0 +1,177 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+// 有界无锁多生产者多消费者队列(Dmitry Vyukov的bounded MPMC queue)
+// 每个格子带一个序号，生产者/消费者各自用CAS推进位置，再用序号发布/回收格子，
+// 元素直接存放在预先分配的格子中，入队出队都不分配内存。容量向上取整为2的幂
+template <typename T>
+class MpmcQueue
+{
+public:
+    explicit MpmcQueue(size_t capacity);
+
+    MpmcQueue(const MpmcQueue &) = delete;
+    MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+    bool tryPush(T &&item); // 队列满时返回false，item保持不变
+    bool tryPop(T &item);   // 队列空时返回false
+    // 用一次CAS占用连续的空闲格子，移入items的前若干个，返回移入的个数(队列满时可能小于n)
+    size_t tryPushBatch(T *items, size_t n);
+    size_t sizeApprox() const;
+    size_t capacity() const;
+
+private:
+    struct alignas(64) Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<size_t> enqueuePos_;
+    alignas(64) std::atomic<size_t> dequeuePos_;
+};
+
+template <typename T>
+MpmcQueue<T>::MpmcQueue(size_t capacity) : enqueuePos_(0), dequeuePos_(0)
+{
+    size_t cap = 2;
+    while (cap < capacity)
+    {
+        cap <<= 1;
+    }
+    mask_ = cap - 1;
+    cells_.reset(new Cell[cap]);
+    for (size_t i = 0; i < cap; ++i)
+    {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+bool MpmcQueue<T>::tryPush(T &&item)
+{
+    Cell *cell;
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &cells_[pos & mask_];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0)
+        {
+            /* 格子空闲，抢占这个位置 */
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; /* 格子还没被消费，队列满 */
+        }
+        else
+        {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+    cell->data = std::move(item);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+size_t MpmcQueue<T>::tryPushBatch(T *items, size_t n)
+{
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    size_t count;
+    for (;;)
+    {
+        // 从pos开始数出连续的空闲格子，CAS成功说明期间没有其他生产者占用它们
+        intptr_t diff = 0;
+        for (count = 0; count < n && count <= mask_; ++count)
+        {
+            size_t seq = cells_[(pos + count) & mask_].sequence.load(std::memory_order_acquire);
+            diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + count);
+            if (diff != 0)
+            {
+                break;
+            }
+        }
+        if (count == 0)
+        {
+            if (diff < 0 || n == 0)
+            {
+                return 0; /* 队列满 */
+            }
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+            continue;
+        }
+        if (enqueuePos_.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed))
+        {
+            break;
+        }
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        Cell *cell = &cells_[(pos + i) & mask_];
+        cell->data = std::move(items[i]);
+        cell->sequence.store(pos + i + 1, std::memory_order_release);
+    }
+    return count;
+}
+
+template <typename T>
+bool MpmcQueue<T>::tryPop(T &item)
+{
+    Cell *cell;
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &cells_[pos & mask_];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0)
+        {
+            if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; /* 格子还没被写入，队列空 */
+        }
+        else
+        {
+            pos = dequeuePos_.load(std::memory_order_relaxed);
+        }
+    }
+    item = std::move(cell->data);
+    /* 标记为下一圈的空闲格子 */
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+size_t MpmcQueue<T>::sizeApprox() const
+{
+    size_t enq = enqueuePos_.load(std::memory_order_seq_cst);
+    size_t deq = dequeuePos_.load(std::memory_order_seq_cst);
+    return enq > deq ? enq - deq : 0;
+}
+
+template <typename T>
+size_t MpmcQueue<T>::capacity() const
+{
+    return mask_ + 1;
+}
+
+#endif // MPMC_QUEUE_H
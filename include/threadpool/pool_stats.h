@@ -0,0 +1,187 @@
+#ifndef POOL_STATS_H
+#define POOL_STATS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "../spdlog/spdlog.h"
+#include "inline_task.h"
+
+// 任务的优先级通道，每个通道一个队列，编号越小越优先
+enum TASK_LANE
+{
+    LANE_FAST = 0, // 延迟敏感: 小请求的读取、解析和响应
+    LANE_BULK,     // 大响应没能一次发完时的后续发送
+    LANE_DISK,     // 访问磁盘、用户数据等可能阻塞的请求
+    LANE_NUM,
+};
+
+// 队列中的任务，带入队时间用于统计排队时长
+struct QueuedTask
+{
+    InlineTask task;
+    int64_t enqueueNS = 0;
+};
+
+// 单调时钟的纳秒数
+inline int64_t poolNowNS()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// 一个通道的统计: 队列深度和任务从入队到开始执行的排队时长分布
+struct LaneStats
+{
+    // 排队时长按2的幂分桶(微秒): 第0桶<1us，第k桶[2^(k-1), 2^k)us，最后一桶为>=2^(WAIT_BUCKETS-2)us
+    static const int WAIT_BUCKETS = 22;
+
+    std::atomic<uint64_t> queued{0};    // 入队的任务数，减去开始执行的任务数即为队列深度
+    std::atomic<uint64_t> waitNS{0};    // 累计排队时长
+    std::atomic<uint64_t> maxWaitNS{0}; // 最长排队时长
+    std::atomic<uint64_t> waitHist[WAIT_BUCKETS] = {};
+
+    void recordWait(int64_t ns);
+    uint64_t tasks() const; // 开始执行的任务数，即各桶之和
+    int64_t depth() const;
+    // 排队时长的p分位数(0~1)，返回所在桶的上界(微秒)
+    uint64_t waitPercentileUS(double p) const;
+    std::string toString() const;
+};
+
+// 线程池的运行统计，全部使用relaxed原子操作
+struct PoolStats
+{
+    std::atomic<int> threads{0};      // 当前工作线程数
+    std::atomic<int> peakThreads{0};  // 历史最大线程数
+    std::atomic<uint64_t> grows{0};   // 因排队过久增加线程的次数
+    std::atomic<uint64_t> shrinks{0}; // 空闲线程退出的次数
+    LaneStats lanes[LANE_NUM];
+
+    void setThreads(int n);
+    static const char *laneName(int lane);
+    std::string toString() const;
+};
+
+void LaneStats::recordWait(int64_t ns)
+{
+    if (ns < 0)
+    {
+        ns = 0;
+    }
+    uint64_t us = static_cast<uint64_t>(ns) / 1000;
+    int bucket = us == 0 ? 0 : 64 - __builtin_clzll(us);
+    if (bucket >= WAIT_BUCKETS)
+    {
+        bucket = WAIT_BUCKETS - 1;
+    }
+    waitHist[bucket].fetch_add(1, std::memory_order_relaxed);
+    waitNS.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t max = maxWaitNS.load(std::memory_order_relaxed);
+    while (static_cast<uint64_t>(ns) > max &&
+           !maxWaitNS.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+uint64_t LaneStats::tasks() const
+{
+    uint64_t total = 0;
+    for (int i = 0; i < WAIT_BUCKETS; ++i)
+    {
+        total += waitHist[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+int64_t LaneStats::depth() const
+{
+    /* 两个计数分别读取，只是近似值 */
+    int64_t d = static_cast<int64_t>(queued.load(std::memory_order_relaxed) - tasks());
+    return d > 0 ? d : 0;
+}
+
+uint64_t LaneStats::waitPercentileUS(double p) const
+{
+    uint64_t total = 0;
+    uint64_t counts[WAIT_BUCKETS];
+    for (int i = 0; i < WAIT_BUCKETS; ++i)
+    {
+        counts[i] = waitHist[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(p * total);
+    uint64_t seen = 0;
+    for (int i = 0; i < WAIT_BUCKETS; ++i)
+    {
+        seen += counts[i];
+        if (seen > rank)
+        {
+            return 1ULL << i;
+        }
+    }
+    return 1ULL << (WAIT_BUCKETS - 1);
+}
+
+std::string LaneStats::toString() const
+{
+    uint64_t n = tasks();
+    std::string res = fmt::format("depth:{} tasks:{} avg_wait_us:{:.1f} max_wait_us:{}", depth(), n,
+                                  n ? waitNS.load(std::memory_order_relaxed) / 1000.0 / n : 0.0,
+                                  maxWaitNS.load(std::memory_order_relaxed) / 1000);
+    res += fmt::format(" p50<{}us p90<{}us p99<{}us wait_hist:", waitPercentileUS(0.5), waitPercentileUS(0.9),
+                       waitPercentileUS(0.99));
+    /* 只输出非空的桶，格式为 上界us=次数 */
+    for (int i = 0; i < WAIT_BUCKETS; ++i)
+    {
+        uint64_t c = waitHist[i].load(std::memory_order_relaxed);
+        if (c && i + 1 < WAIT_BUCKETS)
+        {
+            res += fmt::format(" <{}us={}", 1ULL << i, c);
+        }
+        else if (c)
+        {
+            res += fmt::format(" >={}us={}", 1ULL << (i - 1), c);
+        }
+    }
+    return res;
+}
+
+void PoolStats::setThreads(int n)
+{
+    threads.store(n, std::memory_order_relaxed);
+    int peak = peakThreads.load(std::memory_order_relaxed);
+    while (n > peak && !peakThreads.compare_exchange_weak(peak, n, std::memory_order_relaxed))
+    {
+    }
+}
+
+const char *PoolStats::laneName(int lane)
+{
+    static const char *names[LANE_NUM + 1] = {"fast", "bulk", "disk", "none"};
+    return names[(lane >= 0 && lane < LANE_NUM) ? lane : LANE_NUM];
+}
+
+std::string PoolStats::toString() const
+{
+    std::string res = fmt::format("threads:{} peak:{} grows:{} shrinks:{}", threads.load(std::memory_order_relaxed),
+                                  peakThreads.load(std::memory_order_relaxed), grows.load(std::memory_order_relaxed),
+                                  shrinks.load(std::memory_order_relaxed));
+    for (int i = 0; i < LANE_NUM; ++i)
+    {
+        if (lanes[i].queued.load(std::memory_order_relaxed))
+        {
+            res += fmt::format(" | {} {}", laneName(i), lanes[i].toString());
+        }
+    }
+    return res;
+}
+
+#endif // POOL_STATS_H
@@ -8,77 +8,341 @@
 #include <mutex>
 #include <vector>
 #include <queue>
-#include <future>
-#include <functional>
+#include <atomic>
+#include <stdexcept>
+#include <memory>
+#include <stdint.h>
 
-class ThreadPool
+#include "executor.h"
+#include "mpmc_queue.h"
+#include "../topology/cpu_topology.h"
+
+// 可选的线程池实现
+enum THREADPOOL_TYPE
+{
+    MUTEX_POOL = 0,     // 所有线程共享每个通道一个的有界无锁环形队列，空闲线程在互斥锁+条件变量上休眠
+    WORK_STEALING_POOL, // 每个工作线程每个通道一个Chase-Lev双端队列，空闲时窃取
+};
+
+// 线程池的可调参数
+struct PoolOptions
+{
+    int type = MUTEX_POOL;
+    // 工作线程没有任务时先自旋检查spinRounds轮再休眠，避免短暂空闲时频繁futex唤醒(WORK_STEALING_POOL)
+    int spinRounds = 64;
+    // 外部线程投递任务的有界环形队列容量，满时退回到互斥锁保护的溢出队列
+    size_t queueCapacity = 4096;
+    // 非空时第i个工作线程绑定到cpus[i % cpus.size()]
+    std::vector<int> cpus;
+    // 弹性伸缩: maxThreads大于初始线程数时启用，线程数在[初始线程数, maxThreads]之间变化。
+    // 任务排队超过targetWaitUS微秒且没有空闲线程时增加一个线程(每targetWaitUS最多一次)，
+    // 空闲超过idleMS毫秒的线程退出
+    size_t maxThreads = 0;
+    int targetWaitUS = 2000;
+    int idleMS = 30000;
+    // 各通道(TASK_LANE)的调度权重: 多个通道都有任务时，每个工作线程按权重比例轮流优先取各通道，
+    // 优先的通道为空时按通道编号顺序取其他通道
+    int laneWeights[LANE_NUM] = {8, 2, 1};
+};
+
+// 按通道权重生成的轮换顺序(平滑加权轮询)，例如权重{2,1,1}得到0,1,2,0
+class LaneRotation
+{
+public:
+    explicit LaneRotation(const int *weights)
+    {
+        int total = 0, current[LANE_NUM] = {};
+        for (int i = 0; i < LANE_NUM; ++i)
+        {
+            total += weights[i] > 0 ? weights[i] : 0;
+        }
+        for (int n = 0; n < total; ++n)
+        {
+            int best = 0;
+            for (int i = 0; i < LANE_NUM; ++i)
+            {
+                current[i] += weights[i] > 0 ? weights[i] : 0;
+                if (current[i] > current[best])
+                    best = i;
+            }
+            current[best] -= total;
+            order_.push_back(static_cast<uint8_t>(best));
+        }
+        if (order_.empty())
+            order_.push_back(LANE_FAST);
+    }
+
+    // 第k次取任务时各通道的尝试顺序
+    void lanes(size_t k, int *out) const
+    {
+        int first = order_[k % order_.size()];
+        out[0] = first;
+        for (int i = 0, j = 1; i < LANE_NUM; ++i)
+        {
+            if (i != first)
+                out[j++] = i;
+        }
+    }
+
+private:
+    std::vector<uint8_t> order_;
+};
+
+// MUTEX_POOL的实现
+class ThreadPool final : public Executor
 {
 private:
-    bool m_stop;
+    std::atomic<bool> m_stop;
     std::vector<std::thread> m_thread;
-    std::queue<std::function<void()>> tasks;
+    std::vector<std::thread::id> m_exited; // 已经退出、等待join的线程
+    std::unique_ptr<MpmcQueue<QueuedTask>> m_ring[LANE_NUM]; // 任务先进入所在通道的无锁环形队列
+    std::queue<QueuedTask> m_overflow[LANE_NUM];             // 环形队列满时的溢出队列，由m_mutex保护
+    LaneRotation m_rotation;
     std::mutex m_mutex;
     std::condition_variable m_cv;
+    std::atomic<int> m_sleepers; // 休眠中的线程数
+    PoolOptions m_opts;
+    size_t m_minThreads;
+    size_t m_nextIndex; // 下一个新线程的序号，用于选择绑定的CPU
+    int64_t m_lastGrowNS;
+    PoolStats m_stats;
 
-public:
-    explicit ThreadPool(size_t threadNumber) : m_stop(false)
+    static const size_t BATCH_CHUNK = 64; // postBatch每次在栈上转换的任务数
+
+    bool hasTask_()
     {
-        for (size_t i = 0; i < threadNumber; ++i)
-        {   
-            m_thread.emplace_back(
-                [this]()
+        for (int i = 0; i < LANE_NUM; ++i)
+        {
+            if (m_ring[i]->sizeApprox() > 0 || !m_overflow[i].empty())
+                return true;
+        }
+        return false;
+    }
+
+    void initRings_(size_t capacity)
+    {
+        for (int i = 0; i < LANE_NUM; ++i)
+            m_ring[i].reset(new MpmcQueue<QueuedTask>(capacity));
+    }
+
+    bool elastic_() const
+    {
+        return m_opts.maxThreads > m_minThreads;
+    }
+
+    // 在m_mutex下调用
+    void spawn_()
+    {
+        int cpu = m_opts.cpus.empty() ? -1 : m_opts.cpus[m_nextIndex % m_opts.cpus.size()];
+        ++m_nextIndex;
+        m_thread.emplace_back(&ThreadPool::workerLoop_, this, cpu);
+        m_stats.setThreads(static_cast<int>(m_thread.size() - m_exited.size()));
+    }
+
+    // 回收已经退出的线程，在m_mutex下调用
+    void reap_()
+    {
+        for (auto id : m_exited)
+        {
+            for (auto it = m_thread.begin(); it != m_thread.end(); ++it)
+            {
+                if (it->get_id() == id)
+                {
+                    it->join();
+                    m_thread.erase(it);
+                    break;
+                }
+            }
+        }
+        m_exited.clear();
+    }
+
+    // 排队时间超过目标且没有空闲线程时增加一个线程
+    void maybeGrow_(int64_t waitNS, int64_t now)
+    {
+        int64_t target = static_cast<int64_t>(m_opts.targetWaitUS) * 1000;
+        if (waitNS <= target || m_sleepers.load(std::memory_order_relaxed) > 0 ||
+            m_stats.threads.load(std::memory_order_relaxed) >= static_cast<int>(m_opts.maxThreads))
+            return;
+        std::unique_lock<std::mutex> lk(m_mutex);
+        if (m_stop || now - m_lastGrowNS < target)
+            return;
+        reap_();
+        if (m_thread.size() >= m_opts.maxThreads)
+            return;
+        m_lastGrowNS = now;
+        m_stats.grows.fetch_add(1, std::memory_order_relaxed);
+        spawn_();
+    }
+
+    void workerLoop_(int cpu)
+    {
+        if (cpu >= 0)
+            CpuTopology::pinCurrentThread(cpu);
+        size_t pick = 0; // 本线程取任务的次数，决定本次优先的通道
+        for (;;)
+        {
+            QueuedTask qt;
+            int lanes[LANE_NUM];
+            m_rotation.lanes(pick++, lanes);
+            int lane = -1;
+            for (int i = 0; i < LANE_NUM && lane < 0; ++i)
+            {
+                if (m_ring[lanes[i]]->tryPop(qt))
+                    lane = lanes[i];
+            }
+            if (lane < 0)
+            {
+                std::unique_lock<std::mutex> lk(m_mutex);
+                for (int i = 0; i < LANE_NUM && lane < 0; ++i)
                 {
-                    for (;;)
+                    if (!m_overflow[lanes[i]].empty())
                     {
-                        std::function<void()> task;
-                        {
-                            std::unique_lock<std::mutex> lk(m_mutex);
-                            m_cv.wait(lk, [this]()
-                                      { return m_stop || !tasks.empty(); });
-                            if (m_stop && tasks.empty())
-                                return;
-                            task = std::move(tasks.front());
-                            tasks.pop();
-                        }
-                        task();
+                        lane = lanes[i];
+                        qt = std::move(m_overflow[lane].front());
+                        m_overflow[lane].pop();
                     }
-                });
+                }
+                if (lane < 0)
+                {
+                    // 先登记再检查，和wake_中先入队再读取m_sleepers配对，不会丢失唤醒
+                    auto ready = [this]()
+                    { return m_stop || hasTask_(); };
+                    m_sleepers.fetch_add(1);
+                    bool woken = true;
+                    if (elastic_())
+                        woken = m_cv.wait_for(lk, std::chrono::milliseconds(m_opts.idleMS), ready);
+                    else
+                        m_cv.wait(lk, ready);
+                    m_sleepers.fetch_sub(1);
+                    if (m_stop && !hasTask_())
+                        return;
+                    if (!woken && m_thread.size() - m_exited.size() > m_minThreads)
+                    {
+                        /* 空闲太久，退出并等待下次增加线程或析构时join */
+                        m_exited.push_back(std::this_thread::get_id());
+                        m_stats.shrinks.fetch_add(1, std::memory_order_relaxed);
+                        m_stats.setThreads(static_cast<int>(m_thread.size() - m_exited.size()));
+                        return;
+                    }
+                    continue;
+                }
+            }
+            int64_t now = poolNowNS();
+            m_stats.lanes[lane].recordWait(now - qt.enqueueNS);
+            if (elastic_())
+                maybeGrow_(now - qt.enqueueNS, now);
+            qt.task();
         }
     }
 
-    ThreadPool(const ThreadPool &) = delete;
-    ThreadPool(ThreadPool &&) = delete;
-
-    ThreadPool &operator=(const ThreadPool &) = delete;
-    ThreadPool &operator=(ThreadPool &&) = delete;
+public:
+    explicit ThreadPool(size_t threadNumber, const PoolOptions &opts = PoolOptions())
+        : m_stop(false), m_rotation(opts.laneWeights), m_sleepers(0), m_opts(opts), m_minThreads(threadNumber),
+          m_nextIndex(0), m_lastGrowNS(0)
+    {
+        initRings_(opts.queueCapacity);
+        std::lock_guard<std::mutex> lk(m_mutex);
+        for (size_t i = 0; i < threadNumber; ++i)
+        {
+            spawn_();
+        }
+    }
 
-    ~ThreadPool()
+    ~ThreadPool() override
     {
         {
             std::unique_lock<std::mutex> lk(m_mutex);
             m_stop = true;
         }
         m_cv.notify_all();
+        // m_stop之后不会再增加线程
         for (auto &threads : m_thread)
         {
             threads.join();
         }
     }
 
-    template <typename F, typename... Args>
-    auto submit(F &&f, Args &&...args) -> std::future<decltype(f(args...))>
+    const PoolStats &stats() const override
+    {
+        return m_stats;
+    }
+
+    void postTask(InlineTask &&task, int lane = LANE_FAST) override
+    {
+        if (m_stop.load(std::memory_order_relaxed))
+            throw std::runtime_error("submit on stopped ThreadPool");
+        QueuedTask queued;
+        queued.task = std::move(task);
+        queued.enqueueNS = poolNowNS();
+        enqueue_(&queued, 1, lane);
+        wake_(1);
+    }
+
+    // 一次向lane通道投递n个任务(移走tasks中的内容)：入队只做一次同步，之后最多唤醒n个休眠的线程
+    void postBatch(InlineTask *tasks, size_t n, int lane = LANE_FAST) override
     {
-        auto taskPtr = std::make_shared<std::packaged_task<decltype(f(args...))()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+        if (m_stop.load(std::memory_order_relaxed))
+            throw std::runtime_error("submit on stopped ThreadPool");
+        if (n == 0)
+            return;
+        // 一批任务共用一个入队时间
+        int64_t now = poolNowNS();
+        QueuedTask queued[BATCH_CHUNK];
+        for (size_t done = 0; done < n;)
+        {
+            size_t cnt = n - done < BATCH_CHUNK ? n - done : BATCH_CHUNK;
+            for (size_t i = 0; i < cnt; ++i)
+            {
+                queued[i].task = std::move(tasks[done + i]);
+                queued[i].enqueueNS = now;
+            }
+            enqueue_(queued, cnt, lane);
+            done += cnt;
+        }
+        wake_(n);
+    }
+
+private:
+    // 放入环形队列，放不下的进入溢出队列
+    void enqueue_(QueuedTask *queued, size_t n, int lane)
+    {
+        if (lane < 0 || lane >= LANE_NUM)
+            lane = LANE_FAST;
+        m_stats.lanes[lane].queued.fetch_add(n, std::memory_order_relaxed);
+        size_t pushed = m_ring[lane]->tryPushBatch(queued, n);
+        if (pushed < n)
         {
             std::unique_lock<std::mutex> lk(m_mutex);
-            if (m_stop)
-                throw std::runtime_error("submit on stopped ThreadPool");
-            tasks.emplace([taskPtr]()
-                          { (*taskPtr)(); });
+            for (size_t i = pushed; i < n; ++i)
+            {
+                m_overflow[lane].push(std::move(queued[i]));
+            }
+        }
+    }
+
+    // 唤醒最多n个休眠的线程
+    void wake_(size_t n)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int sleepers = m_sleepers.load();
+        if (sleepers > 0)
+        {
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+            }
+            if (n >= static_cast<size_t>(sleepers))
+            {
+                m_cv.notify_all();
+            }
+            else
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    m_cv.notify_one();
+                }
+            }
         }
-        m_cv.notify_one();
-        return taskPtr->get_future();
     }
 };
 
@@ -0,0 +1,559 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+#include "thread_pool.h"
+
+// Chase-Lev工作窃取双端队列(Lê et al. 2013的C11内存序版本)，容量固定
+// 只有所属线程push/pop底部，其他线程从顶部steal
+template <typename T>
+class WorkStealingDeque
+{
+public:
+    explicit WorkStealingDeque(size_t capacity = 4096);
+
+    WorkStealingDeque(const WorkStealingDeque &) = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+    bool push(T *item); // 队列满时返回false
+    T *pop();
+    T *steal();
+    bool empty() const;
+
+private:
+    std::atomic<int64_t> top_;
+    std::atomic<int64_t> bottom_;
+    size_t mask_;
+    std::unique_ptr<std::atomic<T *>[]> buffer_;
+};
+
+template <typename T>
+WorkStealingDeque<T>::WorkStealingDeque(size_t capacity) : top_(0), bottom_(0)
+{
+    size_t cap = 1;
+    while (cap < capacity)
+    {
+        cap <<= 1;
+    }
+    mask_ = cap - 1;
+    buffer_.reset(new std::atomic<T *>[cap]);
+}
+
+template <typename T>
+bool WorkStealingDeque<T>::push(T *item)
+{
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_acquire);
+    if (b - t > static_cast<int64_t>(mask_))
+    {
+        return false;
+    }
+    buffer_[b & mask_].store(item, std::memory_order_relaxed);
+    bottom_.store(b + 1, std::memory_order_release); /* 与steal中对bottom_的acquire配对，发布item */
+    return true;
+}
+
+template <typename T>
+T *WorkStealingDeque<T>::pop()
+{
+    int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    T *item = nullptr;
+    if (t <= b)
+    {
+        item = buffer_[b & mask_].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            /* 最后一个元素，和steal竞争 */
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                item = nullptr;
+            }
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+    }
+    else
+    {
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return item;
+}
+
+template <typename T>
+T *WorkStealingDeque<T>::steal()
+{
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b)
+    {
+        return nullptr;
+    }
+    T *item = buffer_[t & mask_].load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return nullptr; /* 被其他线程抢先 */
+    }
+    return item;
+}
+
+template <typename T>
+bool WorkStealingDeque<T>::empty() const
+{
+    return bottom_.load(std::memory_order_acquire) <= top_.load(std::memory_order_acquire);
+}
+
+// 工作窃取线程池(WORK_STEALING_POOL)，可以直接替换ThreadPool
+// 事件循环等外部线程投递的任务进入全局的有界无锁环形队列(满时进入溢出队列)，不分配内存；
+// 工作线程内部投递的任务放入自己预先分配的格子，格子指针进入自己的双端队列，同样不分配内存；自己的队列为空时先取全局队列，再从其他线程窃取。
+// 空闲时先自旋spinRounds轮再休眠，有线程在自旋时投递方不再唤醒休眠的线程。
+// 每个通道(TASK_LANE)有各自的全局队列和双端队列，按PoolOptions::laneWeights轮流优先。
+// 弹性伸缩时按maxThreads预先创建全部双端队列，线程退出后它的位置可以被新线程复用
+class WorkStealingPool final : public Executor
+{
+public:
+    WorkStealingPool(size_t threadNumber, const PoolOptions &opts = PoolOptions());
+    ~WorkStealingPool() override;
+
+    void postTask(InlineTask &&task, int lane = LANE_FAST) override;
+    void postBatch(InlineTask *tasks, size_t n, int lane = LANE_FAST) override;
+    const PoolStats &stats() const override { return stats_; }
+
+private:
+    // 内部投递的任务存放的格子，双端队列只能存放指针
+    struct Cell
+    {
+        QueuedTask task;
+        std::atomic<bool> used{false}; // 所属线程放入时置位，取走任务的线程(可能是窃取者)移出任务后清除
+    };
+
+    struct Worker
+    {
+        Worker() : cells(new Cell[CELLS]) {}
+
+        WorkStealingDeque<Cell> deque[LANE_NUM];
+        std::unique_ptr<Cell[]> cells;
+        size_t nextCell = 0; // 只由所属线程访问
+        std::thread thread;
+        bool running = false; // 由parkMutex_保护
+    };
+
+    void run_(size_t index);
+    // 按第pick次取任务的通道顺序，依次从自己的队列、全局队列、其他线程的队列中取，返回所在通道，没有时返回-1
+    int findTask_(size_t index, size_t pick, QueuedTask &task);
+    bool takeInjected_(int lane, QueuedTask &task);
+    void inject_(QueuedTask *queued, size_t n, int lane); // 放入全局队列
+    bool hasWork_() const;
+    void wakeOne_();
+    void wake_(size_t n); // 按新任务数唤醒休眠的线程，自旋中的线程会各取走一个
+    void start_(size_t index); // 在parkMutex_下调用
+    void maybeGrow_(int64_t waitNS, int64_t now);
+
+    static const size_t BATCH_CHUNK = 64; // postBatch每次在栈上转换的任务数
+    static const size_t CELLS = 1024;     // 每个工作线程的格子数，都在使用中时内部投递退回全局队列
+
+    PoolOptions opts_;
+    size_t minThreads_;
+    std::vector<std::unique_ptr<Worker>> workers_; // 大小为最大线程数
+    std::atomic<int> live_;                        // 正在运行的线程数
+    int64_t lastGrowNS_;                           // 由parkMutex_保护
+
+    LaneRotation rotation_;
+    std::unique_ptr<MpmcQueue<QueuedTask>> injected_[LANE_NUM];
+    std::mutex overflowMutex_;
+    std::deque<QueuedTask> overflow_[LANE_NUM]; // injected_满时使用
+    std::atomic<size_t> overflowSize_;           // 所有通道溢出队列的总长度
+
+    std::mutex parkMutex_;
+    std::condition_variable parkCv_;
+    std::atomic<int> sleepers_; // 休眠中的线程数
+    std::atomic<int> spinners_; // 自旋找任务的线程数
+    std::atomic<bool> stop_;
+    PoolStats stats_;
+
+    static thread_local WorkStealingPool *currentPool_;
+    static thread_local size_t currentIndex_;
+};
+
+thread_local WorkStealingPool *WorkStealingPool::currentPool_ = nullptr;
+thread_local size_t WorkStealingPool::currentIndex_ = 0;
+
+// 自旋等待时降低CPU占用
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+WorkStealingPool::WorkStealingPool(size_t threadNumber, const PoolOptions &opts)
+    : opts_(opts), minThreads_(threadNumber), live_(0), lastGrowNS_(0), rotation_(opts.laneWeights),
+      overflowSize_(0), sleepers_(0), spinners_(0), stop_(false)
+{
+    for (int i = 0; i < LANE_NUM; ++i)
+    {
+        injected_[i].reset(new MpmcQueue<QueuedTask>(opts.queueCapacity));
+    }
+    if (minThreads_ == 0)
+    {
+        minThreads_ = 1;
+    }
+    if (std::thread::hardware_concurrency() <= 1)
+    {
+        opts_.spinRounds = 0; /* 单核上自旋只会占住投递方需要的CPU */
+    }
+    size_t capacity = opts_.maxThreads > minThreads_ ? opts_.maxThreads : minThreads_;
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        workers_.emplace_back(new Worker());
+    }
+    /* 所有队列创建完成后再启动线程，窃取时会遍历workers_ */
+    std::lock_guard<std::mutex> lk(parkMutex_);
+    for (size_t i = 0; i < minThreads_; ++i)
+    {
+        start_(i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    stop_.store(true);
+    {
+        std::lock_guard<std::mutex> lk(parkMutex_); /* 之后不会再启动新线程 */
+    }
+    parkCv_.notify_all();
+    for (auto &worker : workers_)
+    {
+        if (worker->thread.joinable())
+        {
+            worker->thread.join();
+        }
+    }
+}
+
+void WorkStealingPool::start_(size_t index)
+{
+    Worker *worker = workers_[index].get();
+    if (worker->thread.joinable())
+    {
+        worker->thread.join(); /* 之前在这个位置退出的线程 */
+    }
+    worker->running = true;
+    stats_.setThreads(live_.fetch_add(1) + 1);
+    worker->thread = std::thread(&WorkStealingPool::run_, this, index);
+}
+
+void WorkStealingPool::maybeGrow_(int64_t waitNS, int64_t now)
+{
+    int64_t target = static_cast<int64_t>(opts_.targetWaitUS) * 1000;
+    if (waitNS <= target || sleepers_.load(std::memory_order_relaxed) > 0 ||
+        live_.load(std::memory_order_relaxed) >= static_cast<int>(workers_.size()))
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lk(parkMutex_);
+    if (stop_.load() || now - lastGrowNS_ < target)
+    {
+        return;
+    }
+    for (size_t i = 0; i < workers_.size(); ++i)
+    {
+        if (!workers_[i]->running)
+        {
+            lastGrowNS_ = now;
+            stats_.grows.fetch_add(1, std::memory_order_relaxed);
+            start_(i);
+            return;
+        }
+    }
+}
+
+void WorkStealingPool::postTask(InlineTask &&task, int lane)
+{
+    if (stop_.load(std::memory_order_relaxed))
+    {
+        throw std::runtime_error("submit on stopped ThreadPool");
+    }
+    if (lane < 0 || lane >= LANE_NUM)
+    {
+        lane = LANE_FAST;
+    }
+    QueuedTask queued;
+    queued.task = std::move(task);
+    queued.enqueueNS = poolNowNS();
+    if (currentPool_ == this)
+    {
+        /* 工作线程内部投递，放入自己的队列；格子的任务被移出后才会清除used，之后才能复用 */
+        Worker *worker = workers_[currentIndex_].get();
+        Cell *cell = &worker->cells[worker->nextCell++ % CELLS];
+        if (!cell->used.load(std::memory_order_acquire))
+        {
+            cell->task = std::move(queued);
+            cell->used.store(true, std::memory_order_relaxed); /* 由push的release发布 */
+            if (worker->deque[lane].push(cell))
+            {
+                stats_.lanes[lane].queued.fetch_add(1, std::memory_order_relaxed);
+                wake_(1);
+                return;
+            }
+            queued = std::move(cell->task);
+            cell->used.store(false, std::memory_order_relaxed);
+        }
+    }
+    inject_(&queued, 1, lane);
+    wake_(1);
+}
+
+void WorkStealingPool::postBatch(InlineTask *tasks, size_t n, int lane)
+{
+    if (currentPool_ == this)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            postTask(std::move(tasks[i]), lane);
+        }
+        return;
+    }
+    if (stop_.load(std::memory_order_relaxed))
+    {
+        throw std::runtime_error("submit on stopped ThreadPool");
+    }
+    if (n == 0)
+    {
+        return;
+    }
+    if (lane < 0 || lane >= LANE_NUM)
+    {
+        lane = LANE_FAST;
+    }
+    // 一批任务共用一个入队时间
+    int64_t now = poolNowNS();
+    QueuedTask queued[BATCH_CHUNK];
+    for (size_t done = 0; done < n;)
+    {
+        size_t cnt = n - done < BATCH_CHUNK ? n - done : BATCH_CHUNK;
+        for (size_t i = 0; i < cnt; ++i)
+        {
+            queued[i].task = std::move(tasks[done + i]);
+            queued[i].enqueueNS = now;
+        }
+        inject_(queued, cnt, lane);
+        done += cnt;
+    }
+    wake_(n);
+}
+
+void WorkStealingPool::inject_(QueuedTask *queued, size_t n, int lane)
+{
+    stats_.lanes[lane].queued.fetch_add(n, std::memory_order_relaxed);
+    size_t pushed = injected_[lane]->tryPushBatch(queued, n);
+    if (pushed < n)
+    {
+        std::lock_guard<std::mutex> lk(overflowMutex_);
+        for (size_t i = pushed; i < n; ++i)
+        {
+            overflow_[lane].push_back(std::move(queued[i]));
+        }
+        overflowSize_.fetch_add(n - pushed, std::memory_order_relaxed);
+    }
+}
+
+void WorkStealingPool::wake_(size_t n)
+{
+    // 先入队再读取sleepers_/spinners_；自旋中的线程会找到任务，只为剩下的任务唤醒休眠的线程
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int spinners = spinners_.load(std::memory_order_seq_cst);
+    if (static_cast<size_t>(spinners) >= n)
+    {
+        return;
+    }
+    int sleepers = sleepers_.load(std::memory_order_seq_cst);
+    if (sleepers <= 0)
+    {
+        return;
+    }
+    size_t need = n - spinners;
+    {
+        std::lock_guard<std::mutex> lk(parkMutex_);
+    }
+    if (need >= static_cast<size_t>(sleepers))
+    {
+        parkCv_.notify_all();
+        return;
+    }
+    for (size_t i = 0; i < need; ++i)
+    {
+        parkCv_.notify_one();
+    }
+}
+
+void WorkStealingPool::wakeOne_()
+{
+    {
+        std::lock_guard<std::mutex> lk(parkMutex_);
+    }
+    parkCv_.notify_one();
+}
+
+bool WorkStealingPool::hasWork_() const
+{
+    if (overflowSize_.load(std::memory_order_seq_cst) > 0)
+    {
+        return true;
+    }
+    for (int lane = 0; lane < LANE_NUM; ++lane)
+    {
+        if (injected_[lane]->sizeApprox() > 0)
+        {
+            return true;
+        }
+        for (auto &worker : workers_)
+        {
+            if (!worker->deque[lane].empty())
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool WorkStealingPool::takeInjected_(int lane, QueuedTask &task)
+{
+    if (injected_[lane]->tryPop(task))
+    {
+        return true;
+    }
+    if (overflowSize_.load(std::memory_order_relaxed) == 0)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lk(overflowMutex_);
+    if (overflow_[lane].empty())
+    {
+        return false;
+    }
+    task = std::move(overflow_[lane].front());
+    overflow_[lane].pop_front();
+    overflowSize_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+int WorkStealingPool::findTask_(size_t index, size_t pick, QueuedTask &task)
+{
+    int lanes[LANE_NUM];
+    rotation_.lanes(pick, lanes);
+    size_t n = workers_.size();
+    for (int k = 0; k < LANE_NUM; ++k)
+    {
+        int lane = lanes[k];
+        // 空队列的pop/steal也要一次全内存屏障，通道多了以后先用empty()跳过，
+        // 漏掉的任务由休眠前的hasWork_()检查兜底
+        WorkStealingDeque<Cell> &own = workers_[index]->deque[lane];
+        Cell *t = own.empty() ? nullptr : own.pop();
+        if (!t && takeInjected_(lane, task))
+        {
+            return lane;
+        }
+        /* 从下一个线程开始依次尝试窃取，分散竞争；已退出线程的队列为空 */
+        for (size_t i = 1; i < n && !t; ++i)
+        {
+            WorkStealingDeque<Cell> &victim = workers_[(index + i) % n]->deque[lane];
+            t = victim.empty() ? nullptr : victim.steal();
+        }
+        if (t)
+        {
+            task = std::move(t->task);
+            t->used.store(false, std::memory_order_release);
+            return lane;
+        }
+    }
+    return -1;
+}
+
+void WorkStealingPool::run_(size_t index)
+{
+    currentPool_ = this;
+    currentIndex_ = index;
+    if (!opts_.cpus.empty())
+    {
+        CpuTopology::pinCurrentThread(opts_.cpus[index % opts_.cpus.size()]);
+    }
+    bool elastic = workers_.size() > minThreads_;
+    size_t pick = 0; // 本线程取任务的次数，决定本次优先的通道
+    for (;;)
+    {
+        QueuedTask task;
+        int lane = findTask_(index, pick++, task);
+        bool found = lane >= 0;
+        if (!found)
+        {
+            // 自旋阶段
+            spinners_.fetch_add(1, std::memory_order_seq_cst);
+            for (int i = 0; i < opts_.spinRounds && !found; ++i)
+            {
+                cpuRelax();
+                lane = findTask_(index, pick, task);
+                found = lane >= 0;
+            }
+            if (spinners_.fetch_sub(1, std::memory_order_seq_cst) == 1 && found && hasWork_())
+            {
+                /* 最后一个自旋的线程找到了任务，投递方不会唤醒其他线程，由它接力 */
+                wakeOne_();
+            }
+        }
+        if (!found)
+        {
+            // 休眠阶段: 先登记再检查，和wake_中先入队再读取sleepers_配对，不会丢失唤醒
+            std::unique_lock<std::mutex> lk(parkMutex_);
+            auto ready = [this]()
+            { return stop_.load() || hasWork_(); };
+            sleepers_.fetch_add(1, std::memory_order_seq_cst);
+            bool woken = true;
+            if (elastic)
+            {
+                woken = parkCv_.wait_for(lk, std::chrono::milliseconds(opts_.idleMS), ready);
+            }
+            else
+            {
+                parkCv_.wait(lk, ready);
+            }
+            sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+            if (stop_.load() && !hasWork_())
+            {
+                return;
+            }
+            if (!woken && live_.load() > static_cast<int>(minThreads_))
+            {
+                /* 空闲太久，退出；自己的队列只有自己会放入，此时一定为空 */
+                workers_[index]->running = false;
+                stats_.shrinks.fetch_add(1, std::memory_order_relaxed);
+                stats_.setThreads(live_.fetch_sub(1) - 1);
+                return;
+            }
+            continue;
+        }
+        int64_t now = poolNowNS();
+        stats_.lanes[lane].recordWait(now - task.enqueueNS);
+        if (elastic)
+        {
+            maybeGrow_(now - task.enqueueNS, now);
+        }
+        task.task();
+    }
+}
+
+#endif // WORK_STEALING_POOL_H
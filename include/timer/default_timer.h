@@ -0,0 +1,18 @@
+#ifndef DEFAULT_TIMER_H
+#define DEFAULT_TIMER_H
+
+#include "timer_queue.h"
+#include "timer.h"
+#include "timing_wheel.h"
+
+// 按照类型创建连接超时定时器
+TimerQueue *newTimerQueue(int type)
+{
+    if (type == TIMING_WHEEL)
+    {
+        return new TimingWheel();
+    }
+    return new HeapTimer();
+}
+
+#endif // DEFAULT_TIMER_H
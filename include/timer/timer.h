@@ -9,10 +9,7 @@
 #include <functional>
 #include <memory>
 
-typedef std::function<void()> TimeoutCallBack;
-typedef std::chrono::high_resolution_clock Clock;
-typedef std::chrono::milliseconds MS;
-typedef Clock::time_point TimeStamp;
+#include "timer_queue.h"
 
 class HeapTimerNode
 {
@@ -28,7 +25,8 @@ public:
     }
 };
 
-class HeapTimer
+// 小根堆定时器，结点按id(fd)索引
+class HeapTimer final : public TimerQueue
 {
     typedef std::shared_ptr<HeapTimerNode> SP_HeapTimerNode;
 
@@ -46,6 +44,14 @@ public:
     // 删除指定id节点，并且用指针触发处理函数
     void work(int id);
 
+    // TimerQueue接口，结点以node->id为定时器id
+    void add(TimerNode *node, int timeoutMS) override;
+    void update(TimerNode *node, int timeoutMS) override;
+    void cancel(TimerNode *node) override;
+    void handleExpired() override;
+    bool nextExpire(TimeStamp *expire) const override;
+    const char *name() const override;
+
     void pop();
     void clear();
 
@@ -63,16 +69,16 @@ private:
 void HeapTimer::siftup_(size_t i)
 {
 
-    size_t j = (i - 1) / 2;
-    while (j >= 0)
+    /* 同一轮循环内添加的定时器过期时间相同，只在严格更早时上移，到堆顶为止 */
+    while (i > 0)
     {
-        if (heap_[j] < heap_[i])
+        size_t j = (i - 1) / 2;
+        if (!(heap_[i] < heap_[j]))
         {
             break;
         }
         swapNode_(i, j);
         i = j;
-        j = (i - 1) / 2;
     }
 }
 
@@ -129,14 +135,14 @@ void HeapTimer::addHeapTimer(int id, int timeout, const TimeoutCallBack &call_ba
         /* 新节点：堆尾插入，调整堆 */
         i = heap_.size();
         ref_[id] = i;
-        heap_.push_back({id, Clock::now() + MS(timeout), call_back});
+        heap_.push_back({id, now_ + MS(timeout), call_back});
         siftup_(i);
     }
     else
     {
         /* 已有结点：调整堆 */
         i = ref_[id];
-        heap_[i].expire = Clock::now() + MS(timeout);
+        heap_[i].expire = now_ + MS(timeout);
         heap_[i].cb = call_back;
         if (!siftdown_(i, heap_.size()))
         {
@@ -161,9 +167,9 @@ void HeapTimer::work(int id)
 void HeapTimer::update(int id, int timeout)
 {
     /* 调整指定id的结点 */
-    heap_[ref_[id]].expire = Clock::now() + MS(timeout);
-    ;
-    siftdown_(ref_[id], heap_.size());
+    size_t i = ref_[id];
+    heap_[i].expire = now_ + MS(timeout);
+    siftdown_(i, heap_.size());
 }
 
 void HeapTimer::handle_expired_event()
@@ -176,12 +182,13 @@ void HeapTimer::handle_expired_event()
     while (!heap_.empty())
     {
         HeapTimerNode node = heap_.front();
-        if (std::chrono::duration_cast<MS>(node.expire - Clock::now()).count() > 0)
+        if (node.expire > now_)
         {
             break;
         }
-        node.cb();
+        /* 先出堆再回调，回调中可能会cancel或add */
         pop();
+        node.cb();
     }
 }
 
@@ -196,13 +203,60 @@ void HeapTimer::clear()
     heap_.clear();
 }
 
+void HeapTimer::add(TimerNode *node, int timeoutMS)
+{
+    /* 只捕获两个指针，std::function不需要额外分配内存 */
+    addHeapTimer(node->id, timeoutMS, [this, node]
+                 { expireCb_(node); });
+}
+
+void HeapTimer::update(TimerNode *node, int timeoutMS)
+{
+    if (ref_.count(node->id) == 0)
+    {
+        add(node, timeoutMS);
+        return;
+    }
+    update(node->id, timeoutMS);
+}
+
+void HeapTimer::cancel(TimerNode *node)
+{
+    auto it = ref_.find(node->id);
+    if (it != ref_.end())
+    {
+        del_(it->second);
+    }
+}
+
+void HeapTimer::handleExpired()
+{
+    handle_expired_event();
+}
+
+const char *HeapTimer::name() const
+{
+    return "heap";
+}
+
+bool HeapTimer::nextExpire(TimeStamp *expire) const
+{
+    if (heap_.empty())
+    {
+        return false;
+    }
+    *expire = heap_.front().expire;
+    return true;
+}
+
 int HeapTimer::getNextTrick()
 {
+    tick();
     handle_expired_event();
-    size_t res = -1;
+    int res = -1;
     if (!heap_.empty())
     {
-        res = std::chrono::duration_cast<MS>(heap_.front().expire - Clock::now()).count();
+        res = std::chrono::duration_cast<MS>(heap_.front().expire - now_).count();
         if (res < 0)
         {
             res = 0;
@@ -0,0 +1,81 @@
+#ifndef TIMER_QUEUE_H
+#define TIMER_QUEUE_H
+
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+
+typedef std::function<void()> TimeoutCallBack;
+// 与timerfd使用的CLOCK_MONOTONIC一致，不受系统时间调整影响
+typedef std::chrono::steady_clock Clock;
+typedef std::chrono::milliseconds MS;
+typedef Clock::time_point TimeStamp;
+
+// 可选的定时器实现
+enum TIMER_TYPE
+{
+    HEAP_TIMER = 0,
+    TIMING_WHEEL,
+};
+
+// 侵入式定时器结点，嵌入在使用者的对象(如连接槽)中，定时器本身不为结点分配内存
+struct TimerNode
+{
+    int id = -1;          // 结点的唯一标识(连接的fd)，HeapTimer用它查找结点在堆中的位置
+    void *data = nullptr; // 过期回调中使用的数据
+    // 以下由TimingWheel维护
+    TimerNode *prev = nullptr; // 非空表示结点在某个桶的链表中
+    TimerNode *next = nullptr;
+    uint64_t expireTick = 0;
+    uint32_t bucket = 0;
+};
+
+// 连接超时定时器的抽象接口，只由所属loop线程使用
+// 所有操作使用tick()缓存的当前时间，由事件循环每轮刷新一次
+class TimerQueue
+{
+public:
+    typedef std::function<void(TimerNode *)> ExpireCallBack;
+
+    TimerQueue() : now_(Clock::now()) {}
+    virtual ~TimerQueue() = default;
+
+    //加入结点，结点已经在定时器中时重新设置过期时间
+    virtual void add(TimerNode *node, int timeoutMS) = 0;
+    //推迟结点的过期时间，结点不在定时器中时加入
+    virtual void update(TimerNode *node, int timeoutMS) = 0;
+    //移除结点，结点不在定时器中时什么也不做
+    virtual void cancel(TimerNode *node) = 0;
+    //移除所有过期的结点并调用过期回调，回调中可以再次add/cancel
+    virtual void handleExpired() = 0;
+    //最早的过期时间(可能略早于实际值)，没有结点时返回false
+    virtual bool nextExpire(TimeStamp *expire) const = 0;
+    //实现名称，用于日志
+    virtual const char *name() const = 0;
+
+    void setExpireCallBack(const ExpireCallBack &cb);
+    // 刷新缓存的当前时间
+    void tick();
+    TimeStamp now() const;
+
+protected:
+    ExpireCallBack expireCb_;
+    TimeStamp now_; // 最近一次tick()的时间
+};
+
+void TimerQueue::setExpireCallBack(const ExpireCallBack &cb)
+{
+    expireCb_ = cb;
+}
+
+void TimerQueue::tick()
+{
+    now_ = Clock::now();
+}
+
+TimeStamp TimerQueue::now() const
+{
+    return now_;
+}
+
+#endif // TIMER_QUEUE_H
@@ -0,0 +1,281 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "timer_queue.h"
+
+// 分层时间轮(与Linux内核早期的timer wheel相同的结构)
+// 第0层256个桶，每桶一个tick；第1~3层各64个桶，每层每桶覆盖下一层一整圈。
+// 结点按过期tick落入对应的桶(双向链表)，add/update/cancel都是O(1)，
+// 第0层转完一圈时把上一层对应桶中的结点重新分配到下层(cascade)。
+// 过期时间按tick向上取整，因此不会早于设置的时间，最多晚一个tick
+class TimingWheel final : public TimerQueue
+{
+public:
+    explicit TimingWheel(int tickMS = 10);
+
+    TimingWheel(const TimingWheel &) = delete;
+    TimingWheel &operator=(const TimingWheel &) = delete;
+
+    void add(TimerNode *node, int timeoutMS) override;
+    void update(TimerNode *node, int timeoutMS) override;
+    void cancel(TimerNode *node) override;
+    void handleExpired() override;
+    bool nextExpire(TimeStamp *expire) const override;
+    const char *name() const override;
+
+    size_t size() const;
+
+private:
+    static const int ROOT_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const int LEVELS = 4;
+    static const uint64_t ROOT_SIZE = 1ULL << ROOT_BITS;
+    static const uint64_t LEVEL_SIZE = 1ULL << LEVEL_BITS;
+    static const uint64_t ROOT_MASK = ROOT_SIZE - 1;
+    static const uint64_t LEVEL_MASK = LEVEL_SIZE - 1;
+    static const size_t BUCKETS = ROOT_SIZE + (LEVELS - 1) * LEVEL_SIZE;
+    static const uint64_t MAX_DELTA = (1ULL << (ROOT_BITS + (LEVELS - 1) * LEVEL_BITS)) - 1;
+
+    uint64_t tickOf_(TimeStamp t, bool roundUp) const;
+    void place_(TimerNode *node);            // 按过期tick放入对应的桶
+    void unlink_(TimerNode *node);           // 从所在的桶中摘下
+    bool cascade_(int level, uint64_t index); // 重新分配上层的一个桶，返回index是否为0
+    bool findRoot_(uint64_t *tick) const;    // 第0层中从curTick_开始第一个非空桶对应的tick
+
+    int64_t tickNS_;
+    TimeStamp start_;
+    uint64_t curTick_; // 下一个待处理的tick
+    size_t size_;
+    bool expiring_;    // 正在调用过期回调，此时不能移动curTick_
+    TimerNode heads_[BUCKETS];         // 每个桶的链表头(哨兵)
+    uint64_t bitmap_[BUCKETS / 64];    // 非空桶的位图，用于快速计算最早的过期时间
+};
+
+TimingWheel::TimingWheel(int tickMS)
+    : tickNS_(static_cast<int64_t>(tickMS) * 1000000), start_(now_), curTick_(0), size_(0), expiring_(false), bitmap_{}
+{
+    for (size_t i = 0; i < BUCKETS; ++i)
+    {
+        heads_[i].prev = heads_[i].next = &heads_[i];
+    }
+}
+
+size_t TimingWheel::size() const
+{
+    return size_;
+}
+
+const char *TimingWheel::name() const
+{
+    return "wheel";
+}
+
+uint64_t TimingWheel::tickOf_(TimeStamp t, bool roundUp) const
+{
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t - start_).count();
+    if (ns <= 0)
+    {
+        return 0;
+    }
+    return roundUp ? (ns + tickNS_ - 1) / tickNS_ : ns / tickNS_;
+}
+
+void TimingWheel::add(TimerNode *node, int timeoutMS)
+{
+    if (node->prev)
+    {
+        unlink_(node);
+    }
+    if (size_ == 0 && !expiring_)
+    {
+        /* 空轮的curTick_可能已经落后很久，先追上，免得之后逐个tick空转 */
+        uint64_t cur = tickOf_(now_, false);
+        curTick_ = cur > curTick_ ? cur : curTick_;
+    }
+    node->expireTick = tickOf_(now_ + MS(timeoutMS), true);
+    place_(node);
+}
+
+void TimingWheel::update(TimerNode *node, int timeoutMS)
+{
+    add(node, timeoutMS);
+}
+
+void TimingWheel::cancel(TimerNode *node)
+{
+    if (node->prev)
+    {
+        unlink_(node);
+    }
+}
+
+void TimingWheel::place_(TimerNode *node)
+{
+    // 过期回调中加入的结点不能再落入当前正在处理的桶
+    uint64_t first = expiring_ ? curTick_ + 1 : curTick_;
+    uint64_t expire = node->expireTick < first ? first : node->expireTick;
+    uint64_t delta = expire - curTick_;
+    uint64_t bucket;
+    if (delta < ROOT_SIZE)
+    {
+        bucket = expire & ROOT_MASK;
+    }
+    else
+    {
+        if (delta > MAX_DELTA)
+        {
+            /* 超出时间轮范围，先放在最远的位置，cascade时再重新计算 */
+            expire = curTick_ + MAX_DELTA;
+            delta = MAX_DELTA;
+        }
+        int level = 1;
+        while (delta >= (1ULL << (ROOT_BITS + level * LEVEL_BITS)))
+        {
+            ++level;
+        }
+        int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+        bucket = ROOT_SIZE + (level - 1) * LEVEL_SIZE + ((expire >> shift) & LEVEL_MASK);
+    }
+
+    TimerNode *head = &heads_[bucket];
+    node->bucket = static_cast<uint32_t>(bucket);
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+    bitmap_[bucket >> 6] |= 1ULL << (bucket & 63);
+    ++size_;
+}
+
+void TimingWheel::unlink_(TimerNode *node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = nullptr;
+    TimerNode *head = &heads_[node->bucket];
+    if (head->next == head)
+    {
+        bitmap_[node->bucket >> 6] &= ~(1ULL << (node->bucket & 63));
+    }
+    --size_;
+}
+
+bool TimingWheel::cascade_(int level, uint64_t index)
+{
+    TimerNode *head = &heads_[ROOT_SIZE + (level - 1) * LEVEL_SIZE + index];
+    while (head->next != head)
+    {
+        TimerNode *node = head->next;
+        unlink_(node);
+        place_(node);
+    }
+    return index == 0;
+}
+
+void TimingWheel::handleExpired()
+{
+    uint64_t target = tickOf_(now_, false);
+    if (size_ == 0)
+    {
+        /* 空轮直接跳到当前时间 */
+        if (curTick_ <= target)
+        {
+            curTick_ = target + 1;
+        }
+        return;
+    }
+    while (curTick_ <= target)
+    {
+        uint64_t index = curTick_ & ROOT_MASK;
+        if (index == 0)
+        {
+            for (int level = 1; level < LEVELS; ++level)
+            {
+                int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+                if (!cascade_(level, (curTick_ >> shift) & LEVEL_MASK))
+                {
+                    break;
+                }
+            }
+        }
+
+        // 先把整个桶摘到局部链表再回调，回调中add的结点最早落入下一个tick
+        TimerNode *head = &heads_[index];
+        TimerNode expired;
+        expired.prev = expired.next = &expired;
+        if (head->next != head)
+        {
+            expired.next = head->next;
+            expired.prev = head->prev;
+            expired.next->prev = &expired;
+            expired.prev->next = &expired;
+            head->prev = head->next = head;
+            bitmap_[index >> 6] &= ~(1ULL << (index & 63));
+        }
+        expiring_ = true;
+        while (expired.next != &expired)
+        {
+            TimerNode *node = expired.next;
+            expired.next = node->next;
+            node->next->prev = &expired;
+            node->prev = node->next = nullptr;
+            --size_;
+            expireCb_(node);
+        }
+        expiring_ = false;
+        ++curTick_;
+    }
+}
+
+bool TimingWheel::findRoot_(uint64_t *tick) const
+{
+    uint64_t start = curTick_ & ROOT_MASK;
+    for (uint64_t k = 0; k < ROOT_SIZE;)
+    {
+        uint64_t pos = (start + k) & ROOT_MASK;
+        uint64_t word = bitmap_[pos >> 6] >> (pos & 63);
+        if (word)
+        {
+            k += __builtin_ctzll(word);
+            if (k >= ROOT_SIZE)
+            {
+                break;
+            }
+            *tick = curTick_ + k;
+            return true;
+        }
+        k += 64 - (pos & 63);
+    }
+    return false;
+}
+
+bool TimingWheel::nextExpire(TimeStamp *expire) const
+{
+    if (size_ == 0)
+    {
+        return false;
+    }
+    uint64_t tick = 0;
+    bool found = findRoot_(&tick);
+    bool upper = false;
+    for (size_t i = ROOT_SIZE / 64; i < BUCKETS / 64; ++i)
+    {
+        upper |= bitmap_[i] != 0;
+    }
+    if (upper)
+    {
+        /* 上层结点最早在下一次cascade时落入第0层，curTick_恰好在边界上时就是它本身 */
+        uint64_t cascadeTick = (curTick_ + ROOT_MASK) & ~ROOT_MASK;
+        if (!found || cascadeTick < tick)
+        {
+            tick = cascadeTick;
+        }
+    }
+    *expire = start_ + std::chrono::nanoseconds(tick * tickNS_);
+    return true;
+}
+
+#endif // TIMING_WHEEL_H
@@ -0,0 +1,312 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <algorithm>
+
+#include "../spdlog/spdlog.h"
+
+// 线程放置的可调参数
+struct PlacementOptions
+{
+    bool pinLoops = false;   // 每个事件循环线程绑定到一个CPU
+    bool pinWorkers = false; // 工作线程绑定到事件循环没有占用的CPU
+};
+
+// 一个逻辑CPU在拓扑中的位置
+struct CpuInfo
+{
+    int cpu = -1;
+    int core = -1;    // 物理核编号，只在同一package内唯一
+    int package = -1; // 物理CPU(插槽)
+    int node = 0;     // NUMA节点，没有NUMA信息时都为0
+};
+
+// 从/sys读取本进程可用的CPU及其物理核、插槽和NUMA节点
+// 只包含online且在sched_getaffinity允许范围内的CPU(taskset/cgroup限制后的子集)
+class CpuTopology
+{
+public:
+    // root一般为/sys/devices/system，读取失败时退化为sched_getaffinity给出的扁平拓扑
+    bool load(const std::string &root = "/sys/devices/system");
+
+    const std::vector<CpuInfo> &cpus() const;
+    int cpuCount() const;
+    int coreCount() const; // 物理核数
+    int nodeCount() const;
+
+    // 放置顺序: 先取每个物理核的第一个超线程，NUMA节点之间轮流，再取其余超线程。
+    // 事件循环取前面的CPU，保证各占一个物理核且均匀分布在各节点上
+    std::vector<int> spreadOrder() const;
+    // 按放置顺序给loopNum个事件循环各分配一个CPU
+    std::vector<int> loopCpus(int loopNum) const;
+    // 工作线程使用事件循环没有占用的CPU，没有剩余时使用全部CPU
+    std::vector<int> workerCpus(int loopNum) const;
+
+    // 自动选择线程数: run-to-completion下每个物理核一个loop；
+    // 否则loop只负责分发，每4个物理核一个(至少每个NUMA节点一个)
+    int suggestLoops(bool runToCompletion) const;
+    // 工作线程数: 没有被loop占用的逻辑CPU数，至少2个
+    int suggestWorkers(int loopNum) const;
+
+    std::string toString() const;
+
+    // 把当前线程绑定到cpu，失败时只记录日志
+    static bool pinCurrentThread(int cpu);
+    // 解析"0-3,8,10-11"格式的CPU列表
+    static std::vector<int> parseList(const std::string &list);
+
+private:
+    static bool readLine_(const std::string &path, std::string *line);
+    static int readInt_(const std::string &path, int def);
+
+    std::vector<CpuInfo> cpus_;
+};
+
+bool CpuTopology::readLine_(const std::string &path, std::string *line)
+{
+    std::ifstream in(path);
+    return in && std::getline(in, *line);
+}
+
+int CpuTopology::readInt_(const std::string &path, int def)
+{
+    std::string line;
+    if (!readLine_(path, &line) || line.empty())
+    {
+        return def;
+    }
+    return atoi(line.c_str());
+}
+
+std::vector<int> CpuTopology::parseList(const std::string &list)
+{
+    std::vector<int> res;
+    size_t pos = 0;
+    while (pos < list.size())
+    {
+        size_t comma = list.find(',', pos);
+        std::string item = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        pos = comma == std::string::npos ? list.size() : comma + 1;
+        if (item.empty() || !isdigit(static_cast<unsigned char>(item[0])))
+        {
+            continue;
+        }
+        size_t dash = item.find('-');
+        int lo = atoi(item.c_str());
+        int hi = dash == std::string::npos ? lo : atoi(item.c_str() + dash + 1);
+        for (int i = lo; i <= hi; ++i)
+        {
+            res.push_back(i);
+        }
+    }
+    return res;
+}
+
+bool CpuTopology::load(const std::string &root)
+{
+    cpus_.clear();
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool hasMask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    std::string line;
+    std::vector<int> online;
+    if (readLine_(root + "/cpu/online", &line))
+    {
+        online = parseList(line);
+    }
+    bool fromSys = !online.empty();
+    if (!fromSys)
+    {
+        for (int i = 0; hasMask && i < CPU_SETSIZE; ++i)
+        {
+            online.push_back(i);
+        }
+    }
+
+    // 没有NUMA的内核上没有node目录，所有CPU都算作节点0
+    std::map<int, int> nodeOf;
+    if (fromSys && readLine_(root + "/node/online", &line))
+    {
+        for (int node : parseList(line))
+        {
+            std::string cpulist;
+            if (readLine_(root + "/node/node" + std::to_string(node) + "/cpulist", &cpulist))
+            {
+                for (int cpu : parseList(cpulist))
+                {
+                    nodeOf[cpu] = node;
+                }
+            }
+        }
+    }
+
+    for (int cpu : online)
+    {
+        if (hasMask && (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed)))
+        {
+            continue;
+        }
+        CpuInfo info;
+        info.cpu = cpu;
+        std::string topo = root + "/cpu/cpu" + std::to_string(cpu) + "/topology/";
+        info.core = fromSys ? readInt_(topo + "core_id", cpu) : cpu;
+        info.package = fromSys ? readInt_(topo + "physical_package_id", 0) : 0;
+        auto it = nodeOf.find(cpu);
+        info.node = it == nodeOf.end() ? 0 : it->second;
+        cpus_.push_back(info);
+    }
+    return !cpus_.empty();
+}
+
+const std::vector<CpuInfo> &CpuTopology::cpus() const
+{
+    return cpus_;
+}
+
+int CpuTopology::cpuCount() const
+{
+    return static_cast<int>(cpus_.size());
+}
+
+int CpuTopology::coreCount() const
+{
+    std::vector<std::pair<int, int>> cores;
+    for (auto &c : cpus_)
+    {
+        cores.emplace_back(c.package, c.core);
+    }
+    std::sort(cores.begin(), cores.end());
+    return static_cast<int>(std::unique(cores.begin(), cores.end()) - cores.begin());
+}
+
+int CpuTopology::nodeCount() const
+{
+    std::vector<int> nodes;
+    for (auto &c : cpus_)
+    {
+        nodes.push_back(c.node);
+    }
+    std::sort(nodes.begin(), nodes.end());
+    return static_cast<int>(std::unique(nodes.begin(), nodes.end()) - nodes.begin());
+}
+
+std::vector<int> CpuTopology::spreadOrder() const
+{
+    // 每个节点内按(超线程序号, 插槽, 物理核)排序
+    std::map<int, std::vector<std::tuple<int, int, int, int>>> byNode;
+    std::map<std::pair<int, int>, int> seen; // 物理核已经出现的超线程数
+    for (auto &c : cpus_)
+    {
+        int thread = seen[std::make_pair(c.package, c.core)]++;
+        byNode[c.node].emplace_back(thread, c.package, c.core, c.cpu);
+    }
+    // 第一遍在节点之间轮流取各物理核的第一个超线程，第二遍取其余的
+    std::vector<int> order;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        std::vector<std::vector<int>> lists;
+        for (auto &kv : byNode)
+        {
+            std::sort(kv.second.begin(), kv.second.end());
+            std::vector<int> cpus;
+            for (auto &t : kv.second)
+            {
+                if ((std::get<0>(t) == 0) == (pass == 0))
+                {
+                    cpus.push_back(std::get<3>(t));
+                }
+            }
+            lists.push_back(cpus);
+        }
+        for (size_t i = 0;; ++i)
+        {
+            bool more = false;
+            for (auto &cpus : lists)
+            {
+                if (i < cpus.size())
+                {
+                    order.push_back(cpus[i]);
+                    more = true;
+                }
+            }
+            if (!more)
+            {
+                break;
+            }
+        }
+    }
+    return order;
+}
+
+std::vector<int> CpuTopology::loopCpus(int loopNum) const
+{
+    std::vector<int> order = spreadOrder();
+    std::vector<int> res;
+    for (int i = 0; i < loopNum && !order.empty(); ++i)
+    {
+        res.push_back(order[i % order.size()]);
+    }
+    return res;
+}
+
+std::vector<int> CpuTopology::workerCpus(int loopNum) const
+{
+    std::vector<int> order = spreadOrder();
+    if (loopNum < static_cast<int>(order.size()))
+    {
+        return std::vector<int>(order.begin() + loopNum, order.end());
+    }
+    return order;
+}
+
+int CpuTopology::suggestLoops(bool runToCompletion) const
+{
+    int cores = std::max(coreCount(), 1);
+    if (runToCompletion)
+    {
+        return cores;
+    }
+    return std::max(cores / 4, std::max(nodeCount(), 1));
+}
+
+int CpuTopology::suggestWorkers(int loopNum) const
+{
+    return std::max(cpuCount() - loopNum, 2);
+}
+
+std::string CpuTopology::toString() const
+{
+    return fmt::format("cpus:{} cores:{} nodes:{}", cpuCount(), coreCount(), nodeCount());
+}
+
+bool CpuTopology::pinCurrentThread(int cpu)
+{
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+    {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (ret != 0)
+    {
+        spdlog::warn("pin thread to cpu {} failed: {}", cpu, strerror(ret));
+        return false;
+    }
+    return true;
+}
+
+#endif // CPU_TOPOLOGY_H
@@ -16,7 +16,10 @@
 int main(){
     
     // TaoTaoWebserver::addsig(SIGPIPE, SIG_IGN);
-    TaoWebserver tao(10000, 5, 60000, false, 12);
+    // 默认配置保持保守: 互斥锁线程池、不绑定CPU、最小堆定时器、请求交给线程池处理；
+    // ListenOptions/LoopOptions/PoolOptions/PlacementOptions中的优化按需打开，改默认值需要多核机器上的测量
+    // 端口, 触发模式, 超时时间, 优雅退出, 工作线程数, 事件循环数, 连接分发方式
+    TaoWebserver tao(10000, 5, 60000, false, 12, 4, TaoWebserver::REUSEPORT_LISTENER);
     tao.run();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,138 @@
+// HttpRequest测试共用的检查宏和解析辅助函数: 整段到达、任意位置切分和逐字节到达
+#ifndef PARSE_UTIL_H
+#define PARSE_UTIL_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "http/http_request.h"
+
+inline int failures = 0;
+
+#define CHECK(cond)                                                       \
+    do                                                                    \
+    {                                                                     \
+        if (!(cond))                                                      \
+        {                                                                 \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++failures;                                                   \
+        }                                                                 \
+    } while (0)
+
+// 一次解析得到的结果，解析器中的string_view在缓冲区变化后失效，这里全部复制出来
+struct Parsed
+{
+    HttpRequest::PARSE_RESULT result = HttpRequest::PARSE_INCOMPLETE;
+    std::string method, path, version, query, body, user;
+    std::vector<std::pair<std::string, std::string>> headers;
+    bool keepAlive = false;
+    size_t left = 0; // 解析完成后缓冲区中剩余的字节数
+
+    bool operator==(const Parsed &o) const
+    {
+        return result == o.result && method == o.method && path == o.path && version == o.version &&
+               query == o.query && body == o.body && user == o.user && headers == o.headers &&
+               keepAlive == o.keepAlive && left == o.left;
+    }
+};
+
+inline Parsed collect(HttpRequest &req, HttpRequest::PARSE_RESULT result, const Buffer &buff)
+{
+    Parsed out;
+    out.result = result;
+    out.left = buff.readableBytes();
+    if (result != HttpRequest::PARSE_COMPLETE)
+    {
+        return out;
+    }
+    out.method = std::string(req.method());
+    out.path = req.path();
+    out.version = std::string(req.version());
+    out.query = std::string(req.query());
+    for (std::string_view slice : req.bodySlices())
+    {
+        out.body.append(slice.data(), slice.size());
+    }
+    out.user = req.getPost("username");
+    for (const HttpRequest::Header &h : req.headers())
+    {
+        out.headers.emplace_back(std::string(h.name), std::string(h.value));
+    }
+    out.keepAlive = req.isKeepAlive();
+    return out;
+}
+
+// 整段到达
+inline Parsed parseWhole(const std::string &text)
+{
+    HttpRequest req;
+    Buffer buff;
+    buff.append(text);
+    HttpRequest::PARSE_RESULT r = req.parse(buff);
+    return collect(req, r, buff);
+}
+
+// 前split字节先到达，剩下的再到达；初始缓冲区很小，第二段到达时一定会重新分配
+inline Parsed parseSplit(const std::string &text, size_t split)
+{
+    HttpRequest req;
+    Buffer buff(16);
+    buff.append(text.data(), split);
+    HttpRequest::PARSE_RESULT r = req.parse(buff);
+    if (r != HttpRequest::PARSE_INCOMPLETE)
+    {
+        /* 第一段中已经有完整的请求，还没到达的部分也算作剩余 */
+        Parsed out = collect(req, r, buff);
+        out.left += text.size() - split;
+        return out;
+    }
+    buff.append(text.data() + split, text.size() - split);
+    r = req.parse(buff);
+    return collect(req, r, buff);
+}
+
+// 每次到达一个字节
+inline Parsed parseBytewise(const std::string &text)
+{
+    HttpRequest req;
+    Buffer buff(16);
+    HttpRequest::PARSE_RESULT r = HttpRequest::PARSE_INCOMPLETE;
+    size_t i = 0;
+    while (i < text.size() && r == HttpRequest::PARSE_INCOMPLETE)
+    {
+        buff.append(text.data() + i++, 1);
+        r = req.parse(buff);
+    }
+    Parsed out = collect(req, r, buff);
+    out.left += text.size() - i;
+    return out;
+}
+
+// 任意位置切分和逐字节到达时结果都与整段到达一致
+inline bool sameEverywhere(const std::string &text)
+{
+    Parsed whole = parseWhole(text);
+    for (size_t split = 0; split <= text.size(); ++split)
+    {
+        if (!(parseSplit(text, split) == whole))
+        {
+            fprintf(stderr, "  split at %zu of: %s\n", split, text.c_str());
+            return false;
+        }
+    }
+    return parseBytewise(text) == whole;
+}
+
+inline int report(const char *name)
+{
+    if (failures)
+    {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("%s passed\n", name);
+    return 0;
+}
+
+#endif // PARSE_UTIL_H
@@ -0,0 +1,167 @@
+// CharScan的测试: 每种CPU支持的实现在随机输入上和逐字节的参考实现结果一致，
+// 覆盖不足一个步长的区间和最后一步回退重叠读取的尾部；区间紧贴不可访问的页时不会越界读取
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "http/char_scan.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                       \
+    do                                                                    \
+    {                                                                     \
+        if (!(cond))                                                      \
+        {                                                                 \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++failures;                                                   \
+        }                                                                 \
+    } while (0)
+
+static const char *controlRef(const char *p, const char *end)
+{
+    for (; p < end; ++p)
+    {
+        unsigned char ch = static_cast<unsigned char>(*p);
+        if ((ch < 0x20 && ch != '\t') || ch == 0x7f)
+        {
+            return p;
+        }
+    }
+    return end;
+}
+
+static const char *eitherRef(const char *p, const char *end, char a, char b)
+{
+    for (; p < end; ++p)
+    {
+        if (*p == a || *p == b)
+        {
+            return p;
+        }
+    }
+    return end;
+}
+
+// 大部分是可打印字符，少量目标字节，也包含0x80以上的字节和HTAB
+static void fill(char *buf, size_t n, std::mt19937 &rng, unsigned density)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned r = rng() % 1000;
+        if (r < density)
+        {
+            static const char SPECIAL[] = {'\r', '\n', 0, 0x1f, 0x7f, '%', '+', '&', '='};
+            buf[i] = SPECIAL[rng() % sizeof(SPECIAL)];
+        }
+        else if (r < density + 20)
+        {
+            buf[i] = static_cast<char>(0x80 + rng() % 128);
+        }
+        else if (r < density + 40)
+        {
+            buf[i] = '\t';
+        }
+        else
+        {
+            buf[i] = static_cast<char>(0x20 + rng() % 0x5f);
+        }
+    }
+}
+
+// 所有起点和终点组合，长度覆盖0到几个AVX2步长
+static void testRandom(int isa, std::mt19937 &rng)
+{
+    char buf[160];
+    for (int round = 0; round < 300; ++round)
+    {
+        fill(buf, sizeof(buf), rng, round % 3 == 0 ? 0 : 1 + round % 40);
+        for (size_t from = 0; from < 48; ++from)
+        {
+            for (size_t to = from; to <= sizeof(buf); ++to)
+            {
+                const char *p = buf + from, *end = buf + to;
+                const char *got = CharScan::findControl(p, end);
+                CHECK(got == controlRef(p, end));
+                got = CharScan::findEither(p, end, '%', '+');
+                CHECK(got == eitherRef(p, end, '%', '+'));
+                got = CharScan::findEither(p, end, '&', '=');
+                CHECK(got == eitherRef(p, end, '&', '='));
+                if (failures)
+                {
+                    fprintf(stderr, "  isa %s, range [%zu, %zu)\n", CharScan::isaName(isa), from, to);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+// 目标字节只在最后一步重叠读取时才第一次被看到，以及位于已经检查过的重叠部分中(必须被忽略)
+static void testTailOverlap()
+{
+    char buf[96];
+    for (size_t len = 1; len <= 80; ++len)
+    {
+        for (size_t hit = 0; hit < len; ++hit)
+        {
+            memset(buf, 'a', sizeof(buf));
+            buf[hit] = '\n';
+            CHECK(CharScan::findControl(buf, buf + len) == buf + hit);
+            buf[hit] = '+';
+            CHECK(CharScan::findEither(buf, buf + len, '%', '+') == buf + hit);
+            /* 起点之前的目标字节落在重叠读取的范围内，不能被报告 */
+            if (hit + 1 < len)
+            {
+                CHECK(CharScan::findEither(buf + hit + 1, buf + len, '%', '+') == buf + len);
+            }
+        }
+    }
+}
+
+// 区间末尾紧贴PROT_NONE的页，读取越过end会触发SIGSEGV
+static void testGuardPage()
+{
+    long page = sysconf(_SC_PAGESIZE);
+    char *mem = static_cast<char *>(mmap(nullptr, page * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    CHECK(mem != MAP_FAILED);
+    if (mem == MAP_FAILED)
+    {
+        return;
+    }
+    mprotect(mem + page, page, PROT_NONE);
+    char *end = mem + page;
+    memset(mem, 'a', page);
+    for (size_t len = 0; len <= 100; ++len)
+    {
+        CHECK(CharScan::findControl(end - len, end) == end);
+        CHECK(CharScan::findEither(end - len, end, '%', '+') == end);
+    }
+    munmap(mem, page * 2);
+}
+
+int main()
+{
+    std::mt19937 rng(20260101);
+    for (int isa = CharScan::SCALAR; isa < CharScan::ISA_NUM; ++isa)
+    {
+        if (!CharScan::setIsa(isa))
+        {
+            printf("skip %s: not supported by this CPU\n", CharScan::isaName(isa));
+            continue;
+        }
+        testRandom(isa, rng);
+        testTailOverlap();
+        testGuardPage();
+        printf("%s checked\n", CharScan::isaName(isa));
+    }
+    if (failures)
+    {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_char_scan passed\n");
+    return 0;
+}
@@ -0,0 +1,75 @@
+// HttpRequest请求体的测试: chunked解码(块扩展、trailer、任意位置切分)，
+// 长度有歧义的头部组合、非法的块长度行以及maxBodyBytes限制都被拒绝，交给sink的请求体不计入限制
+#include "parse_util.h"
+
+// 整段到达和逐字节到达时都被拒绝
+static bool rejected(const std::string &text)
+{
+    return parseWhole(text).result == HttpRequest::PARSE_ERROR &&
+           parseBytewise(text).result == HttpRequest::PARSE_ERROR;
+}
+
+static void testChunked()
+{
+    std::string text = "POST /login HTTP/1.1\r\nTransfer-Encoding: chunked\r\n"
+                       "Content-Type: application/x-www-form-urlencoded\r\n\r\n"
+                       "9;ext=1\r\nusername=\r\n1A\r\nxy%41z&password=0123456789\r\n0\r\nTrailer: t\r\n\r\n";
+    Parsed chunked = parseWhole(text);
+    CHECK(chunked.result == HttpRequest::PARSE_COMPLETE);
+    CHECK(chunked.body == "username=xy%41z&password=0123456789");
+    CHECK(chunked.user == "xyAz");
+    CHECK(chunked.left == 0);
+    CHECK(sameEverywhere(text));
+}
+
+static void testRejections()
+{
+    // finishHeaders_: 请求体长度有歧义的组合
+    CHECK(rejected("POST / HTTP/1.1\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n"));
+    CHECK(rejected("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nContent-Length: 5\r\n\r\n0\r\n\r\n"));
+    CHECK(rejected("POST / HTTP/1.0\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n"));
+    CHECK(rejected("POST / HTTP/1.1\r\nTransfer-Encoding: gzip, chunked\r\n\r\n0\r\n\r\n"));
+    CHECK(rejected("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n"));
+    CHECK(rejected("POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: 4\r\n\r\nabcd"));
+    CHECK(rejected("POST / HTTP/1.1\r\nContent-Length: +3\r\n\r\nabc"));
+    CHECK(rejected("POST / HTTP/1.1\r\nContent-Length: 12345678901\r\n\r\n"));
+    CHECK(!rejected("POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: 3\r\n\r\nabc"));
+
+    // parseChunkSize_: 非法的块长度行
+    CHECK(rejected("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n\r\n"));
+    CHECK(rejected("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n\r\n"));
+    CHECK(rejected("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3 x\r\nabc\r\n0\r\n\r\n"));
+    CHECK(rejected("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1000000000000000\r\n"));
+    CHECK(rejected("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabcX\r\n0\r\n\r\n"));
+    CHECK(!rejected("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3 ;a=b\r\nabc\r\n0\r\n\r\n"));
+}
+
+// maxBodyBytes: Content-Length、单个块和累计的块长度都受限，交给sink的请求体不计
+static void testBodyLimit()
+{
+    size_t saved = HttpRequest::maxBodyBytes;
+    HttpRequest::maxBodyBytes = 8;
+    CHECK(rejected("POST / HTTP/1.1\r\nContent-Length: 9\r\n\r\n123456789"));
+    CHECK(!rejected("POST / HTTP/1.1\r\nContent-Length: 8\r\n\r\n12345678"));
+    CHECK(rejected("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n9\r\n123456789\r\n0\r\n\r\n"));
+    CHECK(rejected("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n4\r\n1234\r\n4\r\n5678\r\n1\r\n9\r\n0\r\n\r\n"));
+
+    HttpRequest req;
+    size_t sunk = 0;
+    req.setBodyHandler([&sunk](const HttpRequest &) -> HttpRequest::BodySink
+                       { return [&sunk](std::string_view data)
+                                 { sunk += data.size(); return true; }; });
+    Buffer buff;
+    buff.append(std::string("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n10\r\n0123456789abcdef\r\n0\r\n\r\n"));
+    CHECK(req.parse(buff) == HttpRequest::PARSE_COMPLETE);
+    CHECK(sunk == 16);
+    HttpRequest::maxBodyBytes = saved;
+}
+
+int main()
+{
+    testChunked();
+    testRejections();
+    testBodyLimit();
+    return report("test_http_body");
+}
@@ -0,0 +1,50 @@
+// HttpRequest解析器的测试: 请求行、头部、表单和流水线的解析结果，以及格式错误的请求被拒绝
+#include <string.h>
+
+#include "parse_util.h"
+
+static void testParse()
+{
+    Parsed get = parseWhole("GET /index.html?a=1 HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\nAccept: */*\r\n\r\n");
+    CHECK(get.result == HttpRequest::PARSE_COMPLETE);
+    CHECK(get.method == "GET" && get.path == "/index.html" && get.query == "a=1" && get.version == "1.1");
+    CHECK(get.headers.size() == 3 && get.headers[2].first == "Accept" && get.headers[2].second == "*/*");
+    CHECK(get.keepAlive && get.left == 0);
+
+    /* 请求行之前的空行被忽略，头部值中可以有HTAB */
+    Parsed old = parseWhole("\r\nGET / HTTP/1.0\r\nUser-Agent: test\tagent\r\n\r\n");
+    CHECK(old.result == HttpRequest::PARSE_COMPLETE);
+    CHECK(old.path == "/login.html" && old.version == "1.0" && !old.keepAlive);
+    CHECK(old.headers.size() == 1 && old.headers[0].second == "test\tagent");
+
+    Parsed form = parseWhole("POST /login HTTP/1.1\r\nHost: x\r\nContent-Type: application/x-www-form-urlencoded\r\n"
+                             "Content-Length: 35\r\n\r\nusername=a%20b+c&password=p%3D%26w!");
+    CHECK(form.result == HttpRequest::PARSE_COMPLETE);
+    CHECK(form.body.size() == 35);
+    CHECK(form.user == "a b c");
+
+    Parsed pipelined = parseWhole("GET /a HTTP/1.1\r\nConnection: close\r\n\r\nGET /b HTTP/1.1\r\n\r\n");
+    CHECK(pipelined.result == HttpRequest::PARSE_COMPLETE);
+    CHECK(pipelined.path == "/a" && !pipelined.keepAlive);
+    CHECK(pipelined.left == strlen("GET /b HTTP/1.1\r\n\r\n"));
+}
+
+static bool malformed(const std::string &text)
+{
+    return parseWhole(text).result == HttpRequest::PARSE_ERROR;
+}
+
+static void testMalformed()
+{
+    CHECK(malformed("GET / HTTP/1.1\nHost: x\r\n\r\n"));
+    CHECK(malformed("GET / HTTP/1.1\r\nHost: x\ry\r\n\r\n"));
+    CHECK(malformed("GET / HTTP/1.1\r\nBad Name: x\r\n\r\n"));
+    CHECK(malformed("GET /../etc/passwd HTTP/1.1\r\n\r\n"));
+}
+
+int main()
+{
+    testParse();
+    testMalformed();
+    return report("test_http_request");
+}
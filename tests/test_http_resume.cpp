@@ -0,0 +1,37 @@
+// HttpRequest跨多次读取续解析的测试: 任意位置切分和逐字节到达时结果与整段到达一致，
+// 第二段到达时缓冲区重新分配，已解析部分的string_view也要随之更新
+#include "parse_util.h"
+
+static void testSplitEverywhere()
+{
+    const char *requests[] = {
+        "GET /index.html?a=1 HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\nAccept: */*\r\n\r\n",
+        "\r\nGET / HTTP/1.0\r\nUser-Agent: test\tagent\r\n\r\n",
+        "POST /login HTTP/1.1\r\nHost: x\r\nContent-Type: application/x-www-form-urlencoded\r\n"
+        "Content-Length: 35\r\n\r\nusername=a%20b+c&password=p%3D%26w!",
+        "GET /a HTTP/1.1\r\nConnection: close\r\n\r\nGET /b HTTP/1.1\r\n\r\n",
+    };
+    for (const char *text : requests)
+    {
+        CHECK(parseWhole(text).result == HttpRequest::PARSE_COMPLETE);
+        CHECK(sameEverywhere(text));
+    }
+}
+
+// 非法字节在第二段中才到达时同样被拒绝
+static void testSplitError()
+{
+    std::string text = "GET / HTTP/1.1\r\nHost: x\ry\r\n\r\n";
+    for (size_t split = 0; split <= text.size(); ++split)
+    {
+        CHECK(parseSplit(text, split).result == HttpRequest::PARSE_ERROR);
+    }
+    CHECK(parseBytewise(text).result == HttpRequest::PARSE_ERROR);
+}
+
+int main()
+{
+    testSplitEverywhere();
+    testSplitError();
+    return report("test_http_resume");
+}